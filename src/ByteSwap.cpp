@@ -0,0 +1,124 @@
+#include "ByteSwap.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BYTESWAP_SSE2
+#endif
+
+namespace
+{
+    // Skalarer Rest (und Fallback ohne SIMD)
+    void swapTail32(unsigned char* dst, const unsigned char* src, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t v;
+            memcpy(&v, src + i * 4, 4);
+            v = byteSwap32(v);
+            memcpy(dst + i * 4, &v, 4);
+        }
+    }
+
+    void swapTail64(unsigned char* dst, const unsigned char* src, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t v;
+            memcpy(&v, src + i * 8, 8);
+            v = byteSwap64(v);
+            memcpy(dst + i * 8, &v, 8);
+        }
+    }
+
+#if defined(BYTESWAP_SSE2)
+    // Ohne pshufb: erst die Bytes in jedem 16-Bit-Wort tauschen, dann die Wörter umsortieren
+    inline __m128i swapBytes16(__m128i v)
+    {
+        return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+#endif
+}
+
+void copyWords32(void* dst, const void* src, size_t count, bool swap)
+{
+    if (!swap)
+    {
+        memcpy(dst, src, count * 4);
+        return;
+    }
+
+    unsigned char* out = static_cast<unsigned char*>(dst);
+    const unsigned char* in = static_cast<const unsigned char*>(src);
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4), _mm256_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSSE3__)
+    const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(BYTESWAP_SSE2)
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = swapBytes16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4)));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), v);
+    }
+#endif
+
+    swapTail32(out + i * 4, in + i * 4, count - i);
+}
+
+void copyWords64(void* dst, const void* src, size_t count, bool swap)
+{
+    if (!swap)
+    {
+        memcpy(dst, src, count * 8);
+        return;
+    }
+
+    unsigned char* out = static_cast<unsigned char*>(dst);
+    const unsigned char* in = static_cast<const unsigned char*>(src);
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i mask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 8), _mm256_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSSE3__)
+    const __m128i mask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 8), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(BYTESWAP_SSE2)
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i v = swapBytes16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 8)));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 8), v);
+    }
+#endif
+
+    swapTail64(out + i * 8, in + i * 8, count - i);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Byte order helpers for snapshots written on machines with the other endianness.
+
+inline uint32_t byteSwap32(uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0x0000FF00u) | ((v << 8) & 0x00FF0000u) | (v << 24);
+}
+
+inline uint64_t byteSwap64(uint64_t v)
+{
+    return ((uint64_t)byteSwap32((uint32_t)v) << 32) | byteSwap32((uint32_t)(v >> 32));
+}
+
+// Swaps a 4 or 8 byte value (int, unsigned, float, double) in place
+template <typename T>
+inline void byteSwapInPlace(T& value)
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "only 4 and 8 byte values");
+    if (sizeof(T) == 4)
+    {
+        uint32_t v;
+        memcpy(&v, &value, 4);
+        v = byteSwap32(v);
+        memcpy(&value, &v, 4);
+    }
+    else
+    {
+        uint64_t v;
+        memcpy(&v, &value, 8);
+        v = byteSwap64(v);
+        memcpy(&value, &v, 8);
+    }
+}
+
+// Copy count 4 / 8 byte words from src to dst, swapping the byte order of each word
+// if swap is set. src and dst may be unaligned but must not overlap.
+// Uses AVX2 / SSSE3 / SSE2 depending on what the compiler targets.
+void copyWords32(void* dst, const void* src, size_t count, bool swap);
+void copyWords64(void* dst, const void* src, size_t count, bool swap);
@@ -0,0 +1,104 @@
+#include "ColorMap.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Stützstellen im Abstand 1/8, dazwischen wird linear interpoliert
+    const uint8_t viridisStops[9][3] = {
+        { 68, 1, 84 }, { 71, 44, 122 }, { 59, 81, 139 }, { 44, 113, 142 }, { 33, 144, 141 },
+        { 39, 173, 129 }, { 92, 200, 99 }, { 170, 220, 50 }, { 253, 231, 37 }
+    };
+    const uint8_t infernoStops[9][3] = {
+        { 0, 0, 4 }, { 31, 12, 72 }, { 85, 15, 109 }, { 136, 34, 106 }, { 186, 54, 85 },
+        { 227, 89, 51 }, { 249, 142, 9 }, { 249, 203, 53 }, { 252, 255, 164 }
+    };
+
+    void interpolateStops(const uint8_t stops[9][3], std::vector<uint8_t>& lut)
+    {
+        for (int i = 0; i < ColorMap::LUT_SIZE; i++)
+        {
+            double t = i / double(ColorMap::LUT_SIZE - 1) * 8.0;
+            int k = std::min((int)t, 7);
+            double f = t - k;
+            for (int c = 0; c < 3; c++)
+            {
+                lut[3 * i + c] = (uint8_t)std::lround(stops[k][c] * (1.0 - f) + stops[k + 1][c] * f);
+            }
+        }
+    }
+}
+
+const char* ColorMap::name(int colorMode)
+{
+    switch (colorMode)
+    {
+    case JET: return "jet";
+    case GALACTIC: return "galactic";
+    case VIRIDIS: return "viridis";
+    case INFERNO: return "inferno";
+    }
+    return "unknown";
+}
+
+std::vector<uint8_t> ColorMap::lookupTable(int colorMode)
+{
+    std::vector<uint8_t> lut;
+    if (colorMode == VIRIDIS || colorMode == INFERNO)
+    {
+        lut.resize(3 * LUT_SIZE);
+        interpolateStops(colorMode == VIRIDIS ? viridisStops : infernoStops, lut);
+    }
+    if (colorMode == JET)
+    {
+        lut.resize(3 * LUT_SIZE);
+        for (int i = 0; i < LUT_SIZE; i++)
+        {
+            double t = i / double(LUT_SIZE - 1);
+            double r = std::clamp(1.5 - std::abs(4.0 * t - 3.0), 0.0, 1.0);
+            double g = std::clamp(1.5 - std::abs(4.0 * t - 2.0), 0.0, 1.0);
+            double b = std::clamp(1.5 - std::abs(4.0 * t - 1.0), 0.0, 1.0);
+            lut[3 * i] = (uint8_t)std::lround(r * 255.0);
+            lut[3 * i + 1] = (uint8_t)std::lround(g * 255.0);
+            lut[3 * i + 2] = (uint8_t)std::lround(b * 255.0);
+        }
+    }
+    return lut;
+}
+
+void ColorMap::init()
+{
+    for (int colorMode = FIRST; colorMode <= LAST; colorMode++)
+    {
+        std::vector<uint8_t> lut = lookupTable(colorMode);
+        if (lut.empty()) continue;
+
+        glGenTextures(1, &textures[colorMode]);
+        glBindTexture(GL_TEXTURE_1D, textures[colorMode]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB8, LUT_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, lut.data());
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+void ColorMap::bind(int colorMode, GLuint unit) const
+{
+    if (colorMode < FIRST || colorMode > LAST || textures[colorMode] == 0)
+    {
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_1D, textures[colorMode]);
+}
+
+void ColorMap::release()
+{
+    for (GLuint& texture : textures)
+    {
+        if (texture != 0) glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
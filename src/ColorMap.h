@@ -0,0 +1,34 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstdint>
+
+// Colormaps for the density render modes. The galactic map is computed in the
+// shader, the others are 1D lookup textures sampled with the normalized density.
+class ColorMap
+{
+public:
+    // Werte für Engine::colorMode
+    static const int JET = 1;
+    static const int GALACTIC = 2;
+    static const int VIRIDIS = 3;
+    static const int INFERNO = 4;
+    static const int FIRST = JET;
+    static const int LAST = INFERNO;
+
+    static const int LUT_SIZE = 256;
+
+    static const char* name(int colorMode);
+    // LUT_SIZE RGB entries, empty for maps that have no lookup table
+    static std::vector<uint8_t> lookupTable(int colorMode);
+
+    // Creates the lookup textures, needs the GL context
+    void init();
+    // Binds the texture of colorMode to the given texture unit (nothing for GALACTIC)
+    void bind(int colorMode, GLuint unit) const;
+    void release();
+
+private:
+    GLuint textures[LAST + 1] = {};
+};
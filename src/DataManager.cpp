@@ -7,6 +7,10 @@
 #include <algorithm>
 #include <filesystem>
 #include <iomanip>
+#include <cstring>
+#include <map>
+#include <atomic>
+#include "ByteSwap.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -24,677 +28,723 @@ DataManager::~DataManager()
 {
 }
 
-void DataManager::loadData(int timeStep, std::vector<std::shared_ptr<Particle>>& particles, Engine* eng)
+bool DataManager::buildIndex()
 {
-    std::string filename = this->path + std::to_string(timeStep);
-    std::string ending = ".ag";
-    try
-    {
-        ending = ".ag";
-        outputDataFormat = "ag";
-        std::ifstream file(filename + ending);
-        if (!file)
+    snapshots.clear();
+
+    std::error_code ec;
+    if (!fs::is_directory(path, ec))
+    {
+        std::cerr << "Error: data folder not found: " << path << std::endl;
+        return false;
+    }
+
+    // Reihenfolge = Priorität, falls eine Nummer in mehreren Formaten vorliegt
+    const std::vector<std::string> formats = { "ag", "agc", "age", "gadget" };
+
+    // Nummer -> Format -> Teil -> Pfad (Teil -1 = Snapshot in einer einzigen Datei)
+    std::map<int, std::map<std::string, std::map<int, fs::path>>> candidates;
+    for (const auto& dirEntry : fs::directory_iterator(path, ec))
+    {
+        if (!dirEntry.is_regular_file(ec)) continue;
+
+        fs::path file = dirEntry.path();
+        std::string extension = file.extension().string();
+        std::string stem = file.stem().string();
+        std::string format;
+        int part = -1;
+
+        if (extension.size() >= 2 && extension.size() <= 10 && extension.find_first_not_of("0123456789", 1) == std::string::npos)
+        {
+            // Teil eines Gadget Multi-File Snapshots: "snap_012.3" oder "12.gadget.3"
+            part = std::stoi(extension.substr(1));
+            format = "gadget";
+            if (fs::path(stem).extension() == ".gadget") stem = fs::path(stem).stem().string();
+        }
+        else if (extension.empty())
+        {
+            // Gadget ohne Endung, z.B. "snapshot_012"
+            format = "gadget";
+        }
+        else
+        {
+            format = extension.substr(1);
+            if (std::find(formats.begin(), formats.end(), format) == formats.end()) continue;
+        }
+
+        // Nummer = Ziffern am Ende des Dateinamens, z.B. "12.ag" oder "snap_012.ag"
+        size_t digits = stem.find_last_not_of("0123456789") + 1;
+        if (digits == stem.size() || stem.size() - digits > 9) continue;
+
+        candidates[std::stoi(stem.substr(digits))][format][part] = file;
+    }
+
+    for (auto& byNumber : candidates)
+    {
+        for (const std::string& format : formats)
         {
-            ending = ".agc";
-            outputDataFormat = "agc";
-            file = std::ifstream
-            (filename + ending);
-            if (!file)
+            auto it = byNumber.second.find(format);
+            if (it == byNumber.second.end()) continue;
+
+            SnapshotEntry entry;
+            entry.number = byNumber.first;
+            entry.format = format;
+
+            std::map<int, fs::path>& parts = it->second;
+            if (parts.count(-1))
             {
-                ending = ".age";
-                outputDataFormat = "age";
-                file = std::ifstream
-                (filename + ending);
-                if (!file)
+                // Liegt der Snapshot auch als einzelne Datei vor, wird diese genommen
+                SnapshotFile file;
+                file.path = parts[-1].string();
+                file.fileSize = fs::file_size(parts[-1], ec);
+                entry.files.push_back(file);
+            }
+            else
+            {
+                // Teile müssen lückenlos von 0 an nummeriert sein
+                if (parts.begin()->first != 0 || parts.rbegin()->first != (int)parts.size() - 1)
                 {
-                    ending = ".gadget";
-                    outputDataFormat = "gadget";
-                    file = std::ifstream
-                    (filename + ending);
-                    if (!file)
-                    {
-                        std::cerr << "Error opening datafile: " << filename << std::endl;
-                        return;
-                    }
+                    std::cerr << "Warning: snapshot " << entry.number << " has missing parts, skipping" << std::endl;
+                    continue;
                 }
+                for (auto& kv : parts)
+                {
+                    SnapshotFile file;
+                    file.path = kv.second.string();
+                    file.fileSize = fs::file_size(kv.second, ec);
+                    entry.files.push_back(file);
+                }
+            }
+
+            if (!readIndexHeader(entry))
+            {
+                std::cerr << "Warning: skipping unreadable snapshot " << entry.files.front().path << std::endl;
+                continue;
             }
+            snapshots.push_back(entry);
+            break;
         }
-        file.close();
     }
-    catch (const std::exception&)
+
+    if (snapshots.empty())
     {
-        std::cerr << "Error opening datafile: " << filename << std::endl;
-        return;
+        std::cerr << "Error: no snapshots found in " << path << std::endl;
+        return false;
     }
 
-    filename = filename + ending;
+    outputDataFormat = snapshots.front().format;
+    std::cout << snapshots.size() << " snapshots found (" << outputDataFormat << ")" << std::endl;
+    return true;
+}
 
-    std::ifstream file(filename, std::ios::in | std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Error opening datafile: " << filename << std::endl;
-        return;
+bool DataManager::readGadgetIndexHeader(SnapshotFile& file, double& time, int& numFiles)
+{
+    std::ifstream stream(file.path, std::ios::in | std::ios::binary);
+    unsigned int block_size_start = 0;
+    stream.read(reinterpret_cast<char*>(&block_size_start), sizeof(block_size_start));
+    bool swap = false;
+    bool format2 = false;
+    if (!stream || !detectGadgetFormat(block_size_start, swap, format2))
+    {
+        return false;
+    }
+    if (format2)
+    {
+        // Label-Block "HEAD" überspringen
+        stream.seekg(16);
+        stream.read(reinterpret_cast<char*>(&block_size_start), sizeof(block_size_start));
+        if (swap) block_size_start = byteSwap32(block_size_start);
     }
 
-    particles.clear();
+    gadget2Header header;
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!stream || (format2 && block_size_start != sizeof(header)))
+    {
+        return false;
+    }
+    if (swap) swapHeader(header);
+    for (int i = 0; i < 6; i++)
+    {
+        file.numParticles[i] = header.npart[i];
+    }
+    time = header.time;
+    numFiles = header.num_files;
+    return true;
+}
 
-    if (outputDataFormat == "ag")
+bool DataManager::detectGadgetFormat(unsigned int firstMarker, bool& swap, bool& format2)
+{
+    // Format 1 beginnt mit dem 256 Byte Header, Format 2 mit dem 8 Byte Label-Block
+    swap = false;
+    format2 = false;
+    for (int attempt = 0; attempt < 2; attempt++)
     {
-        // Header auslesen
-        AGFHeader header;
-        file.read(reinterpret_cast<char*>(&header), sizeof(header));
-        if (!file) 
+        if (firstMarker == sizeof(gadget2Header)) return true;
+        if (firstMarker == 8)
         {
-            std::cerr << "Fehler: Konnte den AGF-Header nicht lesen!" << std::endl;
+            format2 = true;
+            return true;
         }
-        // Anzahl der Partikel berechnen
-        unsigned int total_particles = header.numParticles[0] + header.numParticles[1] + header.numParticles[2];
-    
-        eng->numOfParticles = total_particles;
-        eng->numTimeSteps = header.endTime / header.deltaTime;
-        eng->deltaTime = header.deltaTime;
-        
-        // Speicherplatz für Partikel reservieren
-        particles.reserve(total_particles);
-
-        size_t totalSize = header.numParticles[0] + header.numParticles[1] + header.numParticles[2];
-        totalSize *= (sizeof(vec3) + sizeof(double) * 4 + sizeof(uint8_t) * 2 + sizeof(uint32_t));
-
-        // Speicher für den Puffer allokieren
-        char* buffer = reinterpret_cast<char*>(malloc(totalSize));
-        if (buffer) {
-            file.read(buffer, totalSize);
-            char* ptr = buffer;
-
-            for (int i = 0; i < totalSize / (sizeof(vec3) + sizeof(double) * 4 + sizeof(uint8_t) * 2 + sizeof(uint32_t)); i++) 
+        firstMarker = byteSwap32(firstMarker);
+        swap = true;
+    }
+    return false;
+}
+
+bool DataManager::scanGadgetBlocks(MappedFile& file, const std::string& path, std::vector<GadgetBlock>& blocks, gadget2Header& header, bool& swap)
+{
+    auto readMarker = [&file, &swap](size_t position, unsigned int& value) {
+        const char* ptr = file.range(position, sizeof(value));
+        if (!ptr) return false;
+        memcpy(&value, ptr, sizeof(value));
+        if (swap) value = byteSwap32(value);
+        return true;
+    };
+
+    unsigned int firstMarker = 0;
+    bool format2 = false;
+    if (!readMarker(0, firstMarker) || !detectGadgetFormat(firstMarker, swap, format2))
+    {
+        std::cerr << "Fehler: Kein Gadget-Header am Dateianfang: " << path << std::endl;
+        return false;
+    }
+
+    // Nur die Marker (und bei Format 2 die Labels) werden gelesen, nicht die Daten
+    size_t position = 0;
+    while (position < file.size())
+    {
+        GadgetBlock block;
+        if (format2)
+        {
+            unsigned int labelStart = 0, labelEnd = 0;
+            const char* label = file.range(position + sizeof(unsigned int), 4);
+            if (!readMarker(position, labelStart) || !label || !readMarker(position + 12, labelEnd) || labelStart != 8 || labelEnd != 8)
             {
-                vec3 position;
-                double mass, T, visualDensity, sfr;
-                uint8_t type;
-                uint8_t galaxyPart;
-                uint32_t id;
-
-                memcpy(&position, ptr, sizeof(vec3)); ptr += sizeof(vec3);
-                memcpy(&mass, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&T, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&visualDensity, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&sfr, ptr, sizeof(double)); ptr += sizeof(double); // not used yet
-                memcpy(&type, ptr, sizeof(uint8_t)); ptr += sizeof(uint8_t);
-                memcpy(&galaxyPart, ptr, sizeof(uint8_t)); ptr += sizeof(uint8_t);
-                memcpy(&id, ptr, sizeof(uint32_t)); ptr += sizeof(uint32_t);
-
-                auto particle = std::make_shared<Particle>();
-                particle->position = position;
-                particle->mass = mass;
-                particle->temperature = T;
-                particle->density = visualDensity;
-                particle->type = type;
-                particle->galaxyPart = galaxyPart;
-                particle->id = id;
-
-                particles.push_back(particle);
+                break;
             }
-            free(buffer);
+            block.name.assign(label, 4);
+            block.name.erase(block.name.find_last_not_of(' ') + 1);
+            position += 16;
         }
+
+        unsigned int block_size_start = 0, block_size_end = 0;
+        if (!readMarker(position, block_size_start) || !readMarker(position + sizeof(unsigned int) + block_size_start, block_size_end) || block_size_start != block_size_end)
+        {
+            // Kaputte oder abgeschnittene Blöcke am Ende: fehlt ein benötigter Block, meldet das der Leser
+            break;
+        }
+        block.offset = position + sizeof(unsigned int);
+        block.size = block_size_start;
+        blocks.push_back(block);
+        position += block.size + 2 * sizeof(unsigned int);
     }
-    else if (outputDataFormat == "agc")
+
+    if (blocks.empty() || blocks[0].size != sizeof(gadget2Header) || (format2 && blocks[0].name != "HEAD"))
     {
-        // Header auslesen
-        AGFHeader header;
-        file.read(reinterpret_cast<char*>(&header), sizeof(header));
-        if (!file) 
+        std::cerr << "Fehler: Konnte den Gadget-Header nicht lesen: " << path << std::endl;
+        return false;
+    }
+    memcpy(&header, file.range(blocks[0].offset, sizeof(header)), sizeof(header));
+    if (swap) swapHeader(header);
+
+    if (!format2)
+    {
+        // Format 1 hat keine Labels, die Namen ergeben sich aus der festen Reihenfolge
+        std::vector<std::string> names = { "HEAD", "POS", "VEL", "ID" };
+        bool individualMass = false;
+        for (int type = 0; type < 6; type++)
         {
-            std::cerr << "Fehler: Konnte den AGFE-Header nicht lesen!" << std::endl;
+            if (header.massarr[type] == 0 && header.npart[type] > 0) individualMass = true;
         }
-        // Anzahl der Partikel berechnen
-        unsigned int total_particles = header.numParticles[0] + header.numParticles[1] + header.numParticles[2];
-    
-        eng->numOfParticles = total_particles;
-        eng->numTimeSteps = header.endTime / header.deltaTime;
-        eng->deltaTime = header.deltaTime;
-        
-        // Speicherplatz für Partikel reservieren
-        particles.reserve(total_particles);
-
-        // Berechnung der Datenstrukturgröße für jedes Particle
-        size_t particleDataSize = sizeof(float) * 3 + sizeof(float) * 3 + sizeof(uint8_t)* 2;
-
-        // Speicher für das Lesen der Daten allokieren
-        std::vector<char> buffer(total_particles * particleDataSize);
-        file.read(buffer.data(), total_particles * particleDataSize);
-
-        // Zeiger für das Lesen der Partikeldaten initialisieren
-        const char* ptr = buffer.data();
-        for (int i = 0; i < total_particles; i++) {
-            
-            auto particle = std::make_shared<Particle>();
-
-            // Position einlesen
-            float posX, posY, posZ;
-            memcpy(&posX, ptr, sizeof(float)); ptr += sizeof(float);
-            memcpy(&posY, ptr, sizeof(float)); ptr += sizeof(float);
-            memcpy(&posZ, ptr, sizeof(float)); ptr += sizeof(float);
-            particle->position = {posX, posY, posZ};
-
-            // visualDensity einlesen
-            float visualDensity;
-            memcpy(&visualDensity, ptr, sizeof(float)); ptr += sizeof(float);
-            particle->density = visualDensity;
-            float sfr;
-            memcpy(&sfr, ptr, sizeof(float)); ptr += sizeof(float);
-            //particle->sfr = sfr;
-            float T;
-            memcpy(&T, ptr, sizeof(float)); ptr += sizeof(float);
-            particle->temperature = T;
-
-            // type einlesen
-            memcpy(&particle->type, ptr, sizeof(uint8_t)); ptr += sizeof(uint8_t);
-            memcpy(&particle->galaxyPart, ptr, sizeof(uint8_t)); ptr += sizeof(uint8_t);
-
-            particles.push_back(particle);
+        if (individualMass) names.push_back("MASS");
+        if (header.npart[0] > 0)
+        {
+            names.push_back("U");
+            names.push_back("RHO");
+            names.push_back("HSML");
         }
-    }
-    else if (outputDataFormat == "age")
-    {
-        // Header auslesen
-        AGFHeader header;
-        file.read(reinterpret_cast<char*>(&header), sizeof(header));
-        if (!file) 
+        for (size_t i = 0; i < blocks.size() && i < names.size(); i++)
         {
-            std::cerr << "Fehler: Konnte den AGFE-Header nicht lesen!" << std::endl;
+            blocks[i].name = names[i];
         }
-        // Anzahl der Partikel berechnen
-        unsigned int total_particles = header.numParticles[0] + header.numParticles[1] + header.numParticles[2];
-    
-        eng->numOfParticles = total_particles;
-        eng->numTimeSteps = header.endTime / header.deltaTime;
-        eng->deltaTime = header.deltaTime;
-        
-        // Speicherplatz für Partikel reservieren
-        particles.reserve(total_particles);
-
-        size_t totalSize = header.numParticles[0] + header.numParticles[1] + header.numParticles[2];
-        totalSize *= (sizeof(vec3) * 2 + sizeof(double) * 5 + sizeof(uint8_t) * 2 + sizeof(uint32_t));
-
-        // Speicher für den Puffer allokieren
-        char* buffer = reinterpret_cast<char*>(malloc(totalSize));
-        if (buffer) 
+    }
+    return true;
+}
+
+void DataManager::swapHeader(gadget2Header& header)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        byteSwapInPlace(header.npart[i]);
+        byteSwapInPlace(header.massarr[i]);
+        byteSwapInPlace(header.npartTotal[i]);
+        byteSwapInPlace(header.npartTotalHighWord[i]);
+    }
+    byteSwapInPlace(header.time);
+    byteSwapInPlace(header.redshift);
+    byteSwapInPlace(header.flag_sfr);
+    byteSwapInPlace(header.flag_feedback);
+    byteSwapInPlace(header.flag_cooling);
+    byteSwapInPlace(header.num_files);
+    byteSwapInPlace(header.BoxSize);
+    byteSwapInPlace(header.Omega0);
+    byteSwapInPlace(header.OmegaLambda);
+    byteSwapInPlace(header.HubbleParam);
+    byteSwapInPlace(header.flag_stellarage);
+    byteSwapInPlace(header.flag_metals);
+    byteSwapInPlace(header.flag_entropy_instead_u);
+}
+
+bool DataManager::readIndexHeader(SnapshotEntry& entry)
+{
+    for (const SnapshotFile& file : entry.files)
+    {
+        entry.fileSize += file.fileSize;
+    }
+
+    if (entry.format == "gadget")
+    {
+        for (size_t f = 0; f < entry.files.size(); f++)
         {
-            file.read(buffer, totalSize);
-            char* ptr = buffer;
-
-            for (int i = 0; i < totalSize / (sizeof(vec3) * 2 + sizeof(double) * 5 + sizeof(uint8_t) * 2 + sizeof(uint32_t)); i++) {
-                vec3 position, velocity;
-                double mass, T, P, visualDensity, U;
-                uint8_t type;
-                uint8_t galaxyPart;
-                uint32_t id;
-
-
-                memcpy(&position, ptr, sizeof(vec3)); ptr += sizeof(vec3);
-                memcpy(&velocity, ptr, sizeof(vec3)); ptr += sizeof(vec3);
-                memcpy(&mass, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&T, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&P, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&visualDensity, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&U, ptr, sizeof(double)); ptr += sizeof(double);
-                memcpy(&type, ptr, sizeof(uint8_t)); ptr += sizeof(uint8_t);
-                memcpy(&galaxyPart, ptr, sizeof(uint8_t)); ptr += sizeof(uint8_t);
-                memcpy(&id, ptr, sizeof(uint32_t)); ptr += sizeof(uint32_t);
-
-                auto particle = std::make_shared<Particle>();
-                particle->position = position;
-                particle->velocity = velocity;
-                particle->mass = mass;
-                particle->temperature = T;
-                particle->density = visualDensity;
-                particle->type = type;
-                particle->galaxyPart = galaxyPart;
-                particle->id = id;
-
-                particles.push_back(particle);
+            double time = 0;
+            int numFiles = 0;
+            if (!readGadgetIndexHeader(entry.files[f], time, numFiles))
+            {
+                return false;
+            }
+            // Alle Teile müssen vorhanden sein (ältere Dateien schreiben teilweise num_files = 0)
+            if (std::max(numFiles, 1) != (int)entry.files.size())
+            {
+                std::cerr << "Warning: " << entry.files[f].path << " expects " << numFiles << " files, found " << entry.files.size() << std::endl;
+                return false;
+            }
+            if (f == 0) entry.time = time;
+            for (int i = 0; i < 6; i++)
+            {
+                entry.numParticles[i] += entry.files[f].numParticles[i];
+                entry.totalParticles += entry.files[f].numParticles[i];
             }
-            free(buffer);
         }
+        return true;
     }
-    else if (outputDataFormat == "gadget")
+
+    SnapshotFile& agfFile = entry.files.front();
+    std::ifstream file(agfFile.path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
     {
-        // Gadget2 Header auslesen
-        gadget2Header header;
+        return false;
+    }
 
-        // Lesen der ersten Blockgröße vor dem Header
-        unsigned int block_size_start;
-        file.read(reinterpret_cast<char*>(&block_size_start), sizeof(block_size_start));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die Start-Blockgröße nicht lesen!" << std::endl;
-            return;
-        }
+    AGFHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file)
+    {
+        return false;
+    }
 
-        // Lesen des Headers
-        file.read(reinterpret_cast<char*>(&header), sizeof(header));
-        if (!file) {
-            std::cerr << "Fehler: Konnte den Header aus der Datei nicht lesen!" << std::endl;
-            return;
-        }
+    size_t recordSize = sizeof(AGRecord);
+    if (entry.format == "agc") recordSize = sizeof(AGCRecord);
+    if (entry.format == "age") recordSize = sizeof(AGERecord);
 
-        // Lesen der Blockgröße nach dem Header
-        unsigned int block_size_end;
-        file.read(reinterpret_cast<char*>(&block_size_end), sizeof(block_size_end));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die End-Blockgröße des Headers nicht lesen!" << std::endl;
-            return;
-        }
+    for (int i = 0; i < 3; i++)
+    {
+        if (header.numParticles[i] < 0) return false;
+        entry.numParticles[i] = header.numParticles[i];
+        entry.totalParticles += header.numParticles[i];
+        agfFile.numParticles[i] = header.numParticles[i];
+    }
+    entry.time = header.currentTime;
+    entry.deltaTime = header.deltaTime;
+    entry.endTime = header.endTime;
 
-        // Überprüfen, ob die Blockgrößen übereinstimmen
-        if (block_size_start != sizeof(header)) {
-            std::cerr << "Fehler: Start- und End-Blockgrößen des Headers stimmen nicht überein!" << std::endl;
-            return;
-        }
-        /*
-        // Ausgabe des Headers zur Überprüfung
-        std::cout << "Gadget2 Header geladen:" << std::endl;
-        std::cout << "Teilchenanzahl pro Typ:" << std::endl;
-        for (int i = 0; i < 6; ++i) { // Annahme: 6 Typen
-            std::cout << "Typ " << i << ": " << header.npart[i] << " Partikel" << std::endl;
-        }
-        std::cout << "Mass per type:" << std::endl;
-        for (int i = 0; i < 6; ++i) { // Annahme: 6 Typen
-            std::cout << "Typ " << i << ": " << header.massarr[i] << " Mass" << std::endl;
-        }
-        std::cout << "Boxgröße: " << header.BoxSize << std::endl;
-        std::cout << "Hubble-Parameter: " << header.HubbleParam << std::endl;
-        std::cout << "Roteshift: " << header.redshift << std::endl;
-        std::cout << "Simulationszeit: " << header.time << std::endl;
-        */
-    
-        // Gesamtanzahl der Partikel berechnen
-        unsigned int total_particles = 0;
-        for(int i = 0; i < 6; ++i){
-            total_particles += header.npart[i];
-        }
+    // Abgeschnittene Dateien gleich hier aussortieren
+    return sizeof(AGFHeader) + entry.totalParticles * recordSize <= entry.fileSize;
+}
 
-        // Reservieren des Speicherplatzes für Partikel
-        particles.reserve(total_particles);
-
-        // ### Lesen des Positionsblocks (POS) ###
-        
-        // Lesen der Blockgröße vor dem POS-Block
-        unsigned int pos_block_size_start;
-        file.read(reinterpret_cast<char*>(&pos_block_size_start), sizeof(pos_block_size_start));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die Start-Blockgröße des POS-Blocks nicht lesen!" << std::endl;
-            return;
-        }
+void DataManager::loadData(int timeStep, ParticleStore& particles, Engine* eng)
+{
+    SnapshotInfo info;
+    if (loadData(timeStep, particles, info))
+    {
+        applySnapshotInfo(info, eng);
+    }
+}
 
-        // Berechnen der erwarteten Größe für den POS-Block: N * 3 * sizeof(float)
-        unsigned int expected_pos_block_size = total_particles * 3 * sizeof(float);
-        if (pos_block_size_start != expected_pos_block_size) {
-            std::cerr << "Warnung: Erwartete POS-Blockgröße (" << expected_pos_block_size 
-                    << " bytes) stimmt nicht mit gelesener Größe (" << pos_block_size_start << " bytes) überein." << std::endl;
-            // Optional: Fortfahren oder Abbruch
-        }
+void DataManager::applySnapshotInfo(const SnapshotInfo& info, Engine* eng)
+{
+    eng->numOfParticles = info.numParticles;
+    if (info.numTimeSteps > 0)
+    {
+        eng->numTimeSteps = info.numTimeSteps;
+        eng->deltaTime = info.deltaTime;
+    }
+}
 
-        // Lesen der Positionsdaten
-        std::vector<float> positions(total_particles * 3); // N * 3 floats
-        file.read(reinterpret_cast<char*>(positions.data()), pos_block_size_start);
-        if (!file) {
-            std::cerr << "Fehler: Konnte die Positionsdaten nicht lesen!" << std::endl;
-            return;
-        }
+bool DataManager::loadData(int timeStep, ParticleStore& particles, SnapshotInfo& info, uint32_t fields)
+{
+    if (timeStep < 0 || timeStep >= (int)snapshots.size())
+    {
+        std::cerr << "Error: no snapshot for time step " << timeStep << " in " << path << std::endl;
+        return false;
+    }
 
-        // Lesen der Blockgröße nach dem POS-Block
-        unsigned int pos_block_size_end;
-        file.read(reinterpret_cast<char*>(&pos_block_size_end), sizeof(pos_block_size_end));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die End-Blockgröße des POS-Blocks nicht lesen!" << std::endl;
-            return;
-        }
+    const SnapshotEntry& entry = snapshots[timeStep];
+    info.numTimeSteps = (double)snapshots.size();
 
-        // Überprüfen, ob die Blockgrößen übereinstimmen
-        if (pos_block_size_start != pos_block_size_end) {
-            std::cerr << "Fehler: Start- und End-Blockgrößen des POS-Blocks stimmen nicht überein!" << std::endl;
-            return;
-        }
+    bool loaded = false;
+    if (entry.format == "ag" || entry.format == "agc" || entry.format == "age")
+    {
+        loaded = loadAGF(entry, particles, info, fields);
+    }
+    else if (entry.format == "gadget")
+    {
+        loaded = loadGadget(entry, particles, info, fields);
+    }
+    else
+    {
+        std::cerr << "Unknown output data format: " << entry.format << std::endl;
+        return false;
+    }
 
-        // ### Lesen des Geschwindigkeitsblocks (VEL) ###
+    // Nach Typ gruppieren und den Octree gleich hier im Loader-Thread bauen,
+    // der Render-Thread bekommt den fertig sortierten Store
+    if (loaded)
+    {
+        particles.octree.build(particles, threadPool);
+    }
+    return loaded;
+}
 
-        // Lesen der Blockgröße vor dem VEL-Block
-        unsigned int vel_block_size_start;
-        file.read(reinterpret_cast<char*>(&vel_block_size_start), sizeof(vel_block_size_start));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die Start-Blockgröße des VEL-Blocks nicht lesen!" << std::endl;
-            return;
-        }
+// Gadget-Typ auf unsere Typen abbilden
+static void gadgetTypeMapping(int gadgetType, uint8_t& particleType, uint8_t& galaxyPart)
+{
+    particleType = 1;
+    galaxyPart = 1;
+    if (gadgetType == 0) { particleType = 2; galaxyPart = 1; } // Gas, Disk
+    if (gadgetType == 1) { particleType = 3; galaxyPart = 3; } // Dark Matter, Halo
+    if (gadgetType == 3) { particleType = 1; galaxyPart = 2; } // Bulge
+    // type 2, 4, 5 -> Sterne in der Disk
+}
 
-        // Berechnen der erwarteten Größe für den VEL-Block: N * 3 * sizeof(float)
-        unsigned int expected_vel_block_size = total_particles * 3 * sizeof(float);
-        if (vel_block_size_start != expected_vel_block_size) {
-            std::cerr << "Warnung: Erwartete VEL-Blockgröße (" << expected_vel_block_size 
-                    << " bytes) stimmt nicht mit gelesener Größe (" << vel_block_size_start << " bytes) überein." << std::endl;
-            // Optional: Fortfahren oder Abbruch
+bool DataManager::loadGadget(const SnapshotEntry& entry, ParticleStore& particles, SnapshotInfo& info, uint32_t fields)
+{
+    // Gesamtlayout wie bei einer einzelnen Datei: erst alle Gas-Partikel aller Dateien, dann Typ 1 usw.
+    // Jede Datei bekommt pro Typ den Startindex ihres Bereichs
+    std::vector<uint64_t> offsets(entry.files.size() * 6);
+    uint64_t typeBegin = 0;
+    for (int type = 0; type < 6; type++)
+    {
+        uint64_t offset = typeBegin;
+        for (size_t f = 0; f < entry.files.size(); f++)
+        {
+            offsets[f * 6 + type] = offset;
+            offset += entry.files[f].numParticles[type];
         }
+        typeBegin += entry.numParticles[type];
+    }
 
-        // Lesen der Geschwindigkeitsdaten
-        std::vector<float> velocities(total_particles * 3); // N * 3 floats
-        file.read(reinterpret_cast<char*>(velocities.data()), vel_block_size_start);
-        if (!file) {
-            std::cerr << "Fehler: Konnte die Geschwindigkeitsdaten nicht lesen!" << std::endl;
-            return;
-        }
+    particles.resize(entry.totalParticles, fields);
+    info.numParticles = entry.totalParticles;
+    info.time = entry.time;
 
-        // Lesen der Blockgröße nach dem VEL-Block
-        unsigned int vel_block_size_end;
-        file.read(reinterpret_cast<char*>(&vel_block_size_end), sizeof(vel_block_size_end));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die End-Blockgröße des VEL-Blocks nicht lesen!" << std::endl;
-            return;
+    // Ein Leser pro Datei, die Bereiche überlappen sich nicht
+    std::atomic<bool> failed{ false };
+    auto readFile = [&](size_t f) {
+        if (!failed && !readGadgetFile(entry.files[f], &offsets[f * 6], particles))
+        {
+            failed = true;
         }
+    };
+    if (threadPool) threadPool->parallelTasks(entry.files.size(), readFile);
+    else for (size_t f = 0; f < entry.files.size(); f++) readFile(f);
 
-        // Überprüfen, ob die Blockgrößen übereinstimmen
-        if (vel_block_size_start != vel_block_size_end) {
-            std::cerr << "Fehler: Start- und End-Blockgrößen des VEL-Blocks stimmen nicht überein!" << std::endl;
-            return;
-        }
+    if (failed)
+    {
+        particles.clear();
+        return false;
+    }
+    return true;
+}
 
-        // ### Lesen des ID-Blocks (ID) ###
+bool DataManager::readGadgetFile(const SnapshotFile& file, const uint64_t offsets[6], ParticleStore& particles)
+{
+    MappedFile mappedFile;
+    if (!mappedFile.open(file.path, useMemoryMapping))
+    {
+        std::cerr << "Error opening datafile: " << file.path << std::endl;
+        return false;
+    }
 
-        // Lesen der Blockgröße vor dem ID-Block
-        unsigned int id_block_size_start;
-        file.read(reinterpret_cast<char*>(&id_block_size_start), sizeof(id_block_size_start));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die Start-Blockgröße des ID-Blocks nicht lesen!" << std::endl;
-            return;
-        }
+    // Blockverzeichnis einmal aufbauen, danach direkt zu den benötigten Blöcken springen
+    std::vector<GadgetBlock> blocks;
+    gadget2Header header;
+    bool swap = false;
+    if (!scanGadgetBlocks(mappedFile, file.path, blocks, header, swap))
+    {
+        return false;
+    }
 
-        // Berechnen der erwarteten Größe für den ID-Block: N * sizeof(unsigned int)
-        unsigned int expected_id_block_size = total_particles * sizeof(unsigned int);
-        if (id_block_size_start != expected_id_block_size) {
-            std::cerr << "Warnung: Erwartete ID-Blockgröße (" << expected_id_block_size 
-                    << " bytes) stimmt nicht mit gelesener Größe (" << id_block_size_start << " bytes) überein." << std::endl;
-            // Optional: Fortfahren oder Abbruch
-        }
+    uint64_t numParticles = 0;
+    uint64_t numWithMass = 0;
+    for (int type = 0; type < 6; type++)
+    {
+        numParticles += header.npart[type];
+        if (header.massarr[type] == 0) numWithMass += header.npart[type];
+    }
 
-        // Lesen der ID-Daten
-        std::vector<unsigned int> ids(total_particles); // N unsigned ints
-        file.read(reinterpret_cast<char*>(ids.data()), id_block_size_start);
-        if (!file) {
-            std::cerr << "Fehler: Konnte die ID-Daten nicht lesen!" << std::endl;
-            return;
-        }
+    auto findBlock = [&blocks](const char* name) {
+        return std::find_if(blocks.begin(), blocks.end(), [name](const GadgetBlock& b) { return b.name == name; });
+    };
 
-        // Lesen der Blockgröße nach dem ID-Block
-        unsigned int id_block_size_end;
-        file.read(reinterpret_cast<char*>(&id_block_size_end), sizeof(id_block_size_end));
-        if (!file) {
-            std::cerr << "Fehler: Konnte die End-Blockgröße des ID-Blocks nicht lesen!" << std::endl;
-            return;
+    // Holt die Daten eines Blocks, elementSize = 0 lässt 4 und 8 Byte Elemente zu
+    auto fetchBlock = [&](const char* name, uint64_t count, size_t& elementSize, const char*& data) {
+        data = nullptr;
+        auto block = findBlock(name);
+        if (block == blocks.end())
+        {
+            std::cerr << "Fehler: " << name << "-Block fehlt: " << file.path << std::endl;
+            return false;
         }
-
-        // Überprüfen, ob die Blockgrößen übereinstimmen
-        if (id_block_size_start != id_block_size_end) {
-            std::cerr << "Fehler: Start- und End-Blockgrößen des ID-Blocks stimmen nicht überein!" << std::endl;
-            return;
+        if (elementSize == 0 && count > 0 && (block->size == count * 4 || block->size == count * 8))
+        {
+            elementSize = block->size / count;
+        }
+        if (block->size != count * elementSize)
+        {
+            std::cerr << "Fehler: Unerwartete " << name << "-Blockgröße (" << block->size << " bytes): " << file.path << std::endl;
+            return false;
         }
+        data = mappedFile.range(block->offset, block->size);
+        if (!data)
+        {
+            std::cerr << "Fehler: Konnte den " << name << "-Block nicht lesen: " << file.path << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    // Nur Blöcke holen, deren Spalten angefordert sind, die anderen werden nie gelesen
+    const uint32_t fields = particles.fields;
+    size_t floatSize = sizeof(float);
+
+    // ### POS ###
+    size_t positionSize = 3 * sizeof(float);
+    const char* positions = nullptr;
+    if (!fetchBlock("POS", numParticles, positionSize, positions)) return false;
+
+    // ### ID ### 32 oder 64 Bit
+    size_t idSize = 0;
+    const char* ids = nullptr;
+    if ((fields & ParticleStore::Id) && !fetchBlock("ID", numParticles, idSize, ids)) return false;
+
+    // ### MASS ### nur für Typen ohne feste Masse im Header
+    const char* masses = nullptr;
+    if (numWithMass > 0 && (fields & ParticleStore::Mass) && !fetchBlock("MASS", numWithMass, floatSize, masses)) return false;
+
+    // ### U ### interne Energie der Gas-Partikel
+    const char* u_values = nullptr;
+    if (header.npart[0] > 0 && (fields & ParticleStore::Temperature) && !fetchBlock("U", header.npart[0], floatSize, u_values)) return false;
+
+    // ### RHO ### Dichte der Gas-Partikel, fehlt z.B. in Anfangsbedingungen
+    const char* rho_values = nullptr;
+    bool hasDensity = findBlock("RHO") != blocks.end();
+    if (header.npart[0] > 0 && (fields & ParticleStore::Density) && hasDensity && !fetchBlock("RHO", header.npart[0], floatSize, rho_values)) return false;
+
+    size_t fileIndex = 0;  // Index innerhalb dieser Datei
+    size_t massIndex = 0;  // Index im MASS-Block
+    for (int type = 0; type < 6; type++)
+    {
+        uint8_t particleType, galaxyPart;
+        gadgetTypeMapping(type, particleType, galaxyPart);
+
+        size_t count = header.npart[type];
+        size_t target = offsets[type];
+        size_t source = fileIndex;
+        size_t massSource = massIndex;
+        bool individualMass = header.massarr[type] == 0;
+        float typeMass = (float)header.massarr[type];
+
+        // Jeder Bereich schreibt nur in seine eigenen Indizes. Die Blöcke werden beim Kopieren
+        // in die Spalten gedreht, Positionen blockweise über einen kleinen Puffer im Cache
+        auto assemble = [&, type, particleType, galaxyPart, target, source, massSource, individualMass, typeMass](size_t begin, size_t end)
+        {
+            const size_t batch = 1024;
+            float pos[3 * batch];
+            uint64_t ids64[batch];
 
-        //read mass:
-        // Überprüfen, ob individuelle Massen vorhanden sind (massarr[i] == 0)
-        const float epsilon = 1e-10;
-        bool has_individual_mass = false;
-        for(int i = 0; i < 6; ++i){
-            if(header.massarr[i] < epsilon)
+            for (size_t first = begin; first < end; first += batch)
             {
-                if(header.npart[i] != 0)
+                size_t n = std::min(batch, end - first);
+                size_t dst = target + first;
+                size_t src = source + first;
+
+                copyWords32(pos, positions + src * 3 * sizeof(float), 3 * n, swap);
+                for (size_t i = 0; i < n; i++)
                 {
-                    has_individual_mass = true;
-                    break;
+                    particles.x[dst + i] = pos[3 * i];
+                    particles.y[dst + i] = pos[3 * i + 1];
+                    particles.z[dst + i] = pos[3 * i + 2];
                 }
-                else
+
+                if (fields & ParticleStore::Id)
                 {
-                    //std::cout << "Mass for type: "<< i << " is 0 because Npart is 0" << std::endl;
+                    if (idSize == sizeof(uint64_t))
+                    {
+                        copyWords64(ids64, ids + src * idSize, n, swap);
+                        for (size_t i = 0; i < n; i++) particles.id[dst + i] = (uint32_t)ids64[i];
+                    }
+                    else
+                    {
+                        copyWords32(&particles.id[dst], ids + src * idSize, n, swap);
+                    }
                 }
-            }
-            else
-            {
-                //std::cout << std::scientific << "Mass for type: "<< i << " is " <<  header.massarr[i] << std::endl;
-            }
-        }
 
-        std::vector<float> masses; // Vektor zur Speicherung der Massen
-        if(has_individual_mass)
-        {
-            // Lesen der Blockgröße vor dem MASS-Block
-            unsigned int mass_block_size_start;
-            file.read(reinterpret_cast<char*>(&mass_block_size_start), sizeof(mass_block_size_start));
-            if (!file) {
-                std::cerr << "Fehler: Konnte die Start-Blockgröße des MASS-Blocks nicht lesen!" << std::endl;
-                return;
-            }
+                if (fields & ParticleStore::Mass)
+                {
+                    if (individualMass) copyWords32(&particles.mass[dst], masses + (massSource + first) * sizeof(float), n, swap);
+                    else std::fill_n(&particles.mass[dst], n, typeMass);
+                }
 
-            // Berechnen der erwarteten Größe für den MASS-Block: N * sizeof(float)
-            unsigned int expected_mass_block_size = total_particles * sizeof(float);
-            if (mass_block_size_start != expected_mass_block_size) {
-                std::cerr << "Warnung: Erwartete MASS-Blockgröße (" << expected_mass_block_size 
-                        << " bytes) stimmt nicht mit gelesener Größe (" << mass_block_size_start << " bytes) überein." << std::endl;
-                // Optional: Fortfahren oder Abbruch
-            }
+                // Interne Energie für Gaspartikel zuweisen, Gas liegt immer vorne
+                if (fields & ParticleStore::Temperature)
+                {
+                    if (type == 0) copyWords32(&particles.temperature[dst], u_values + first * sizeof(float), n, swap);
+                    else std::fill_n(&particles.temperature[dst], n, 0.0f);
+                }
 
-            // Lesen der Massendaten
-            masses.resize(total_particles);
-            file.read(reinterpret_cast<char*>(masses.data()), mass_block_size_start);
-            if (!file) {
-                std::cerr << "Fehler: Konnte die Massendaten nicht lesen!" << std::endl;
-                return;
+                if (fields & ParticleStore::Type) std::fill_n(&particles.type[dst], n, particleType);
+                if (fields & ParticleStore::GalaxyPart) std::fill_n(&particles.galaxyPart[dst], n, galaxyPart);
+                if (fields & ParticleStore::Density)
+                {
+                    if (type == 0 && rho_values) copyWords32(&particles.density[dst], rho_values + first * sizeof(float), n, swap);
+                    else std::fill_n(&particles.density[dst], n, 0.0f);
+                }
             }
+        };
 
-            // Lesen der Blockgröße nach dem MASS-Block
-            unsigned int mass_block_size_end;
-            file.read(reinterpret_cast<char*>(&mass_block_size_end), sizeof(mass_block_size_end));
-            if (!file) {
-                std::cerr << "Fehler: Konnte die End-Blockgröße des MASS-Blocks nicht lesen!" << std::endl;
-                return;
-            }
+        if (threadPool) threadPool->parallelFor(0, count, assemble);
+        else assemble(0, count);
 
-            // Überprüfen, ob die Blockgrößen übereinstimmen
-            if (mass_block_size_start != mass_block_size_end) {
-                std::cerr << "Fehler: Start- und End-Blockgrößen des MASS-Blocks stimmen nicht überein!" << std::endl;
-                return;
-            }
-        }
+        fileIndex += count;
+        if (individualMass) massIndex += count;
+    }
+    return true;
+}
 
-        // ### Lesen des U-Blocks (interne Energie) ###
+template <typename Record>
+void DataManager::decodeParallel(const RecordView<Record>& records, ParticleStore& particles)
+{
+    // Records haben feste Größe, jeder Thread schreibt seinen Bereich direkt in die Spalten
+    if (threadPool)
+    {
+        threadPool->parallelFor(0, records.size(), [&records, &particles](size_t begin, size_t end) {
+            decodeRecords(records, particles, begin, end);
+        });
+    }
+    else
+    {
+        decodeRecords(records, particles, 0, records.size());
+    }
+}
 
-        // Überprüfen, ob Gaspartikel vorhanden sind
-        if(header.npart[0] > 0) // Nur wenn es Gaspartikel gibt
-        {
-            std::cout << "reading U from gas particles" << std::endl;
-            // Lesen der Blockgröße vor dem U-Block
-            unsigned int u_block_size_start;
-            file.read(reinterpret_cast<char*>(&u_block_size_start), sizeof(u_block_size_start));
-            if (!file) {
-                std::cerr << "Fehler: Konnte die Start-Blockgröße des U-Blocks nicht lesen!" << std::endl;
-                return;
-            }
+bool DataManager::loadAGF(const SnapshotEntry& entry, ParticleStore& particles, SnapshotInfo& info, uint32_t fields)
+{
+    const std::string& filename = entry.files.front().path;
+    size_t recordSize = sizeof(AGRecord);
+    if (entry.format == "agc") recordSize = sizeof(AGCRecord);
+    if (entry.format == "age") recordSize = sizeof(AGERecord);
+
+    // Mit Mapping werden die Records direkt aus der Datei gelesen, sonst nur die benötigten Bereiche
+    MappedFile mappedFile;
+    if (!mappedFile.open(filename, useMemoryMapping))
+    {
+        std::cerr << "Error opening datafile: " << filename << std::endl;
+        return false;
+    }
 
-            // Erwartete Größe des U-Blocks berechnen: Anzahl der Gaspartikel * sizeof(float)
-            unsigned int expected_u_block_size = header.npart[0] * sizeof(float);
-            if (u_block_size_start != expected_u_block_size) {
-                std::cerr << "Warnung: Erwartete U-Blockgröße (" << expected_u_block_size 
-                        << " Bytes) stimmt nicht mit gelesener Größe (" << u_block_size_start << " Bytes) überein." << std::endl;
-                // Optional: Fortfahren oder Abbruch
-            }
+    AGFHeader header;
+    const char* ptr = mappedFile.range(0, sizeof(header));
+    if (!ptr)
+    {
+        std::cerr << "Fehler: Konnte den AGF-Header nicht lesen!" << std::endl;
+        return false;
+    }
+    memcpy(&header, ptr, sizeof(header));
+    size_t numRecords = (size_t)header.numParticles[0] + header.numParticles[1] + header.numParticles[2];
 
-            // Lesen der U-Daten
-            std::vector<float> u_values(header.npart[0]); // Interne Energie pro Masseneinheit für Gaspartikel
-            file.read(reinterpret_cast<char*>(u_values.data()), u_block_size_start);
-            if (!file) {
-                std::cerr << "Fehler: Konnte die U-Daten nicht lesen!" << std::endl;
-                return;
-            }
+    const char* records = mappedFile.range(sizeof(header), numRecords * recordSize);
+    if (records == nullptr)
+    {
+        std::cerr << "Fehler: Datei ist kürzer als im Header angegeben: " << filename << std::endl;
+        return false;
+    }
 
-            // Lesen der Blockgröße nach dem U-Block
-            unsigned int u_block_size_end;
-            file.read(reinterpret_cast<char*>(&u_block_size_end), sizeof(u_block_size_end));
-            if (!file) {
-                std::cerr << "Fehler: Konnte die End-Blockgröße des U-Blocks nicht lesen!" << std::endl;
-                return;
-            }
+    info.numParticles = numRecords;
+    info.deltaTime = header.deltaTime;
+    info.time = header.currentTime;
 
-            // Überprüfen, ob die Blockgrößen übereinstimmen
-            if (u_block_size_start != u_block_size_end) {
-                std::cerr << "Fehler: Start- und End-Blockgrößen des U-Blocks stimmen nicht überein!" << std::endl;
-                return;
-            }
-        
-            unsigned int current_particle = 0;
-            unsigned int gas_particle_index = 0;
-            int count_gas = 0;
-            int count_dark = 0;
-            int count_star = 0;
-
-            for(int type = 0; type < 6; ++type)
-            {
-                    for(unsigned int i = 0; i < (unsigned int)header.npart[type]; ++i){
-                        if(current_particle >= total_particles){
-                            std::cerr << "Fehler: Überschreitung der Partikelanzahl beim Erstellen der Partikel!" << std::endl;
-                            return;
-                        }
-                        auto particle = std::make_shared<Particle>();
-                        particle->id = ids[current_particle];
-
-                        if(type == 1)  
-                        {   
-                            particle->type = 3; // Dark Matter
-                            particle->galaxyPart = 3; // Halo
-                            count_dark++;
-                        }
-                        if(type == 2 || type == 4 || type == 5) 
-                        {
-                            particle->type = 1;
-                            particle->galaxyPart = 1;
-                            count_star++;
-                        }
-                        if(type == 3)
-                        {
-                            particle->type = 1;
-                            particle->galaxyPart = 2;
-                            count_star++;
-                        }
-                        if(type == 0) 
-                        {
-                            particle->type = 2; // Gas
-                            particle->galaxyPart = 1; // Disk
-                            count_gas++;
-                        }
-
-                        if(has_individual_mass)
-                        {
-                            particle->mass = masses[current_particle];
-                        }
-                        else
-                        {
-                            particle->mass = header.massarr[type];
-                        }
-
-                        particle->position = vec3(
-                            positions[3*current_particle],
-                            positions[3*current_particle + 1],
-                            positions[3*current_particle + 2]
-                        );
-                        particle->velocity = vec3(
-                            velocities[3*current_particle],
-                            velocities[3*current_particle + 1],
-                            velocities[3*current_particle + 2]
-                        );
-
-                        // Interne Energie für Gaspartikel zuweisen
-                        if(type == 0) // Gaspartikel
-                        {
-                            //scale to SI
-                            particle->temperature = u_values[gas_particle_index];
-                            //std::cout << particle->U << std::endl;
-                            gas_particle_index++;
-                        }
-
-                        particles.push_back(particle);
-                        current_particle++;
-                    }
-                }
-            }
-        else // Wenn keine Gaspartikel vorhanden sind
-        {
-            // Ihr bestehender Code zum Erstellen der Partikel
-            unsigned int current_particle = 0;
-            int count_gas = 0;
-            int count_dark = 0;
-            int count_star = 0;
-
-            for(int type = 0; type < 6; ++type){
-                for(unsigned int i = 0; i < (unsigned int)header.npart[type]; ++i){
-                    if(current_particle >= total_particles){
-                        std::cerr << "Fehler: Überschreitung der Partikelanzahl beim Erstellen der Partikel!" << std::endl;
-                        return;
-                    }
-                    auto particle = std::make_shared<Particle>();
-                    particle->id = ids[current_particle];
-
-                    // Setzen des Partikeltyps und der Masse
-                    if(type == 1)  
-                    {   
-                        particle->type = 3; // Dark Matter
-                        particle->galaxyPart = 3; // Halo
-                        count_dark++;
-                    }
-                    if(type == 2 || type == 4 || type == 5) 
-                    {
-                        particle->type = 1;
-                        particle->galaxyPart = 1;
-                        count_star++;
-                    }
-                    if(type == 3)
-                    {
-                        particle->type = 1;
-                        particle->galaxyPart = 2;
-                        count_star++;
-                    }
-                    if(type == 0) 
-                    {
-                        particle->type = 2; // Gas
-                        particle->galaxyPart = 1; // Disk
-                        count_gas++;
-                    }
+    particles.resize(numRecords, fields);
 
-                    if(has_individual_mass)
-                    {
-                        particle->mass = masses[current_particle];
-                    }
-                    else
-                    {
-                        particle->mass = header.massarr[type];
-                    }
+    if (entry.format == "ag") decodeParallel(RecordView<AGRecord>(records, numRecords), particles);
+    if (entry.format == "agc") decodeParallel(RecordView<AGCRecord>(records, numRecords), particles);
+    if (entry.format == "age") decodeParallel(RecordView<AGERecord>(records, numRecords), particles);
+    return true;
+}
 
-                    particle->position = vec3(
-                        positions[3*current_particle],
-                        positions[3*current_particle + 1],
-                        positions[3*current_particle + 2]
-                    );
-                    particle->velocity = vec3(
-                        velocities[3*current_particle],
-                        velocities[3*current_particle + 1],
-                        velocities[3*current_particle + 2]
-                    );
-
-                    particles.push_back(particle);
-                    current_particle++;
-                }
-            }
-        }
-    }
-    else
+void DataManager::decodeRecords(const RecordView<AGRecord>& records, ParticleStore& particles, size_t begin, size_t end)
+{
+    // Nicht angeforderte Spalten sind leer und werden übersprungen
+    const uint32_t fields = particles.fields;
+    for (size_t i = begin; i < end; i++)
     {
-        std::cerr << "Unknown output data format: " << outputDataFormat << std::endl;
+        const AGRecord& record = records[i];
+        particles.x[i] = (float)record.position[0];
+        particles.y[i] = (float)record.position[1];
+        particles.z[i] = (float)record.position[2];
+        if (fields & ParticleStore::Mass) particles.mass[i] = (float)record.mass;
+        if (fields & ParticleStore::Temperature) particles.temperature[i] = (float)record.temperature;
+        if (fields & ParticleStore::Density) particles.density[i] = (float)record.visualDensity;
+        if (fields & ParticleStore::Type) particles.type[i] = record.type;
+        if (fields & ParticleStore::GalaxyPart) particles.galaxyPart[i] = record.galaxyPart;
+        if (fields & ParticleStore::Id) particles.id[i] = record.id;
     }
+}
 
+void DataManager::decodeRecords(const RecordView<AGCRecord>& records, ParticleStore& particles, size_t begin, size_t end)
+{
+    const uint32_t fields = particles.fields;
+    for (size_t i = begin; i < end; i++)
+    {
+        const AGCRecord& record = records[i];
+        particles.x[i] = record.position[0];
+        particles.y[i] = record.position[1];
+        particles.z[i] = record.position[2];
+        if (fields & ParticleStore::Mass) particles.mass[i] = 1.0f;
+        if (fields & ParticleStore::Temperature) particles.temperature[i] = record.temperature;
+        if (fields & ParticleStore::Density) particles.density[i] = record.visualDensity;
+        if (fields & ParticleStore::Type) particles.type[i] = record.type;
+        if (fields & ParticleStore::GalaxyPart) particles.galaxyPart[i] = record.galaxyPart;
+        if (fields & ParticleStore::Id) particles.id[i] = 0;
+    }
+}
 
-    file.close();
+void DataManager::decodeRecords(const RecordView<AGERecord>& records, ParticleStore& particles, size_t begin, size_t end)
+{
+    // velocity, pressure und internalEnergy werden nie gelesen
+    const uint32_t fields = particles.fields;
+    for (size_t i = begin; i < end; i++)
+    {
+        const AGERecord& record = records[i];
+        particles.x[i] = (float)record.position[0];
+        particles.y[i] = (float)record.position[1];
+        particles.z[i] = (float)record.position[2];
+        if (fields & ParticleStore::Mass) particles.mass[i] = (float)record.mass;
+        if (fields & ParticleStore::Temperature) particles.temperature[i] = (float)record.temperature;
+        if (fields & ParticleStore::Density) particles.density[i] = (float)record.visualDensity;
+        if (fields & ParticleStore::Type) particles.type[i] = record.type;
+        if (fields & ParticleStore::GalaxyPart) particles.galaxyPart[i] = record.galaxyPart;
+        if (fields & ParticleStore::Id) particles.id[i] = record.id;
+    }
 }
 
 #ifdef _WIN32
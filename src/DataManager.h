@@ -4,9 +4,43 @@
 #include <memory>
 #include <vector>
 #include <chrono>
-#include "Particle.h"
+#include <string>
+#include "ParticleStore.h"
 #include "vec3.h"
 #include "Engine.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// Kopfdaten eines geladenen Snapshots
+struct SnapshotInfo
+{
+    size_t numParticles = 0;
+    double deltaTime = 0;
+    double numTimeSteps = 0; // 0 = unbekannt
+    double time = 0;
+};
+
+// Eine Datei eines Snapshots (Gadget-Snapshots können auf mehrere Dateien verteilt sein)
+struct SnapshotFile
+{
+    std::string path;
+    uint64_t fileSize = 0;
+    uint64_t numParticles[6] = { 0, 0, 0, 0, 0, 0 }; // pro Typ in dieser Datei
+};
+
+// Eintrag im Snapshot-Index, wird einmal beim Start aus dem Datenordner gelesen
+struct SnapshotEntry
+{
+    int number = 0;         // Nummer im Dateinamen, darf Lücken haben
+    std::string format;     // "ag", "agc", "age" oder "gadget"
+    std::vector<SnapshotFile> files;
+    uint64_t fileSize = 0;  // Summe über alle Dateien
+    uint64_t numParticles[6] = { 0, 0, 0, 0, 0, 0 }; // pro Typ wie im Header (AGF nutzt nur 3)
+    uint64_t totalParticles = 0;
+    double time = 0;
+    double deltaTime = 0;
+    double endTime = 0;
+};
 
 class DataManager
 {
@@ -16,7 +50,26 @@ public:
     std::string path;    
     std::string outputDataFormat;
 
-    void loadData(int timeStep, std::vector<std::shared_ptr<Particle>>& particles, Engine* eng);
+    // Alle Snapshots im Datenordner, sortiert nach Nummer. Zeitschritt i = snapshots[i]
+    std::vector<SnapshotEntry> snapshots;
+
+    // Durchsucht den Datenordner einmal und liest die Header aller Snapshots
+    bool buildIndex();
+    int numSnapshots() const { return (int)snapshots.size(); }
+
+    // Snapshot-Dateien über mmap einblenden statt mit ifstream zu lesen
+    bool useMemoryMapping = true;
+
+    // Dekodieren und Lesen von Multi-File Snapshots auf mehrere Threads verteilen (nullptr = seriell)
+    ThreadPool* threadPool = nullptr;
+
+    // Lädt einen Zeitschritt, ohne die Engine anzufassen (thread-sicher für einen Loader-Thread).
+    // Die Partikel kommen nach Typ gruppiert und innerhalb eines Typs in Morton-Reihenfolge (ParticleOctree).
+    // fields = benötigte Spalten (ParticleStore::Field), nicht benötigte Blöcke werden nicht gelesen
+    bool loadData(int timeStep, ParticleStore& particles, SnapshotInfo& info, uint32_t fields = ParticleStore::AllFields);
+    void loadData(int timeStep, ParticleStore& particles, Engine* eng);
+
+    static void applySnapshotInfo(const SnapshotInfo& info, Engine* eng);
 
     void printProgress(double currentStep, double steps, std::string text);
 
@@ -32,6 +85,71 @@ private:
         double endTime;
         double currentTime;
     };
+
+    // Record-Layouts der Astrogen2 Formate, so wie sie auf der Platte liegen
+#pragma pack(push, 1)
+    struct AGRecord
+    {
+        double position[3];
+        double mass;
+        double temperature;
+        double visualDensity;
+        double sfr;
+        uint8_t type;
+        uint8_t galaxyPart;
+        uint32_t id;
+    };
+    struct AGCRecord
+    {
+        float position[3];
+        float visualDensity;
+        float sfr;
+        float temperature;
+        uint8_t type;
+        uint8_t galaxyPart;
+    };
+    struct AGERecord
+    {
+        double position[3];
+        double velocity[3];
+        double mass;
+        double temperature;
+        double pressure;
+        double visualDensity;
+        double internalEnergy;
+        uint8_t type;
+        uint8_t galaxyPart;
+        uint32_t id;
+    };
+#pragma pack(pop)
+    static_assert(sizeof(AGRecord) == 62, "unexpected .ag record size");
+    static_assert(sizeof(AGCRecord) == 26, "unexpected .agc record size");
+    static_assert(sizeof(AGERecord) == 94, "unexpected .age record size");
+
+    bool readIndexHeader(SnapshotEntry& entry);
+    bool readGadgetIndexHeader(SnapshotFile& file, double& time, int& numFiles);
+    bool loadAGF(const SnapshotEntry& entry, ParticleStore& particles, SnapshotInfo& info, uint32_t fields);
+    bool loadGadget(const SnapshotEntry& entry, ParticleStore& particles, SnapshotInfo& info, uint32_t fields);
+    bool readGadgetFile(const SnapshotFile& file, const uint64_t offsets[6], ParticleStore& particles);
+    struct gadget2Header;
+    static bool detectGadgetFormat(unsigned int firstMarker, bool& swap, bool& format2);
+    static void swapHeader(gadget2Header& header);
+
+    // Ein Datenblock einer Gadget-Datei. Der Name ist bei Format 2 das Label,
+    // bei Format 1 ergibt er sich aus der festen Reihenfolge der Blöcke
+    struct GadgetBlock
+    {
+        std::string name;
+        size_t offset = 0; // Beginn der Daten hinter dem Blockmarker
+        size_t size = 0;
+    };
+    bool scanGadgetBlocks(MappedFile& file, const std::string& path, std::vector<GadgetBlock>& blocks, gadget2Header& header, bool& swap);
+    template <typename Record>
+    void decodeParallel(const RecordView<Record>& records, ParticleStore& particles);
+    static void decodeRecords(const RecordView<AGRecord>& records, ParticleStore& particles, size_t begin, size_t end);
+    static void decodeRecords(const RecordView<AGCRecord>& records, ParticleStore& particles, size_t begin, size_t end);
+    static void decodeRecords(const RecordView<AGERecord>& records, ParticleStore& particles, size_t begin, size_t end);
+
     //gadget2 header
     struct gadget2Header
     {
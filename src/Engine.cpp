@@ -5,6 +5,7 @@
 #include <memory>
 #include <filesystem>
 #include <algorithm>
+#include <cstring>
 
 #ifdef WIN32
 #include <Windows.h>
@@ -13,147 +14,357 @@
 #include <chrono>
 #include <thread>
 #include <string>
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include "Projection.h"
 
-vec3 Engine::agColorMap(Particle* particle ,double densityAV)
+uint32_t Engine::visibleTypeMask() const
 {
-    BGstars = true;
-    vec3 color;
+    // Bit t = Partikeltyp t wird gezeichnet (1 = Sterne, 2 = Gas, 3 = Dunkle Materie).
+    // Modus 1-5 und 6-10 zeigen dieselben Typen, einmal mit Dichte- und einmal mit Typfarben
+    static const uint32_t modeTypes[5] = {
+        (1u << 1) | (1u << 2) | (1u << 3),  // alle
+        (1u << 1) | (1u << 2),              // Sterne und Gas
+        1u << 1,                            // Sterne
+        1u << 2,                            // Gas
+        1u << 3                             // Dunkle Materie
+    };
+    if (renderMode < 1 || renderMode > 10)
+    {
+        return modeTypes[0];
+    }
+    return modeTypes[(renderMode - 1) % 5];
+}
 
-    if (densityAV != 0) 
+void Engine::setParticleAttributes(size_t offset, size_t count, bool hasDensity, bool hasType, bool hasWeight)
+{
+    // Spalten ab offset: x, y, z, Dichte und Gewicht als float, danach die Typen als Bytes
+    const size_t columnBytes = count * sizeof(float);
+    for (GLuint axis = 0; axis < 3; axis++)
+    {
+        glEnableVertexAttribArray(axis);
+        glVertexAttribPointer(axis, 1, GL_FLOAT, GL_FALSE, sizeof(float), (const void*)(offset + axis * columnBytes));
+    }
+    size_t next = offset + 3 * columnBytes;
+    if (hasDensity)
+    {
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(float), (const void*)next);
+        next += columnBytes;
+    }
+    else
+    {
+        glDisableVertexAttribArray(3);
+    }
+    if (hasWeight)
     {
-        color.x = particle->density / densityAV;
-        color.y = 0;
-        color.z = densityAV * 2 / particle->density;
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(float), (const void*)next);
+        next += columnBytes;
+    }
+    else
+    {
+        glDisableVertexAttribArray(5);
+    }
+    if (hasType)
+    {
+        glEnableVertexAttribArray(4);
+        glVertexAttribIPointer(4, 1, GL_UNSIGNED_BYTE, 1, (const void*)next);
+    }
+    else
+    {
+        glDisableVertexAttribArray(4);
+    }
+}
 
-        double plus = 0;
-        if(particle->density * 100 / densityAV > 1) plus = particle->density / densityAV / 10;
-        if(particle->type == 2) plus *= 4;
-        color.x += plus * 10 + 0.5 - 0.3;
-        color.y += plus - 0.2;
-        color.z += plus + 0.2;
+void Engine::uploadParticles()
+{
+    const ParticleStore emptyStore;
+    const ParticleStore& store = particles ? *particles : emptyStore;
+    const ParticleOctree& octree = store.octree;
+    const size_t n = store.size();
+    const size_t lodN = octree.lodX.size();
+    const bool hasType = store.hasFields(ParticleStore::Type);
+    const bool hasDensity = store.hasFields(ParticleStore::Density);
+
+    // Nur Rohwerte hochladen, die Farbe berechnet der Shader.
+    // Layout einer Region: x, y, z und Dichte als eigene Spalten, dann die Typen.
+    // Dahinter die Aggregate des Octrees genauso, mit dem Gewicht als zusätzlicher Spalte
+    const size_t columnBytes = n * sizeof(float);
+    const size_t densityOffset = 3 * columnBytes;
+    const size_t typeOffset = densityOffset + (hasDensity ? columnBytes : 0);
+    const size_t lodOffset = (typeOffset + (hasType ? n : 0) + 3) & ~(size_t)3;
+    const size_t lodColumnBytes = lodN * sizeof(float);
+    const size_t lodWeightOffset = lodOffset + (hasDensity ? 4 : 3) * lodColumnBytes;
+    const size_t lodTypeOffset = lodWeightOffset + lodColumnBytes;
+    char* region = particleBuffer.beginWrite(lodTypeOffset + (hasType ? lodN : 0));
+
+    if (n > 0)
+    {
+        memcpy(region, store.x.data(), columnBytes);
+        memcpy(region + columnBytes, store.y.data(), columnBytes);
+        memcpy(region + 2 * columnBytes, store.z.data(), columnBytes);
+        if (hasDensity) memcpy(region + densityOffset, store.density.data(), columnBytes);
+        if (hasType) memcpy(region + typeOffset, store.type.data(), n);
+    }
+    if (lodN > 0)
+    {
+        memcpy(region + lodOffset, octree.lodX.data(), lodColumnBytes);
+        memcpy(region + lodOffset + lodColumnBytes, octree.lodY.data(), lodColumnBytes);
+        memcpy(region + lodOffset + 2 * lodColumnBytes, octree.lodZ.data(), lodColumnBytes);
+        if (hasDensity) memcpy(region + lodOffset + 3 * lodColumnBytes, octree.lodDensity.data(), lodColumnBytes);
+        memcpy(region + lodWeightOffset, octree.lodWeight.data(), lodColumnBytes);
+        if (hasType) memcpy(region + lodTypeOffset, octree.lodType.data(), lodN);
+    }
+
+    const size_t offset = particleBuffer.endWrite();
+
+    glBindBuffer(GL_ARRAY_BUFFER, particleBuffer.id());
+    setParticleAttributes(offset, n, hasDensity, hasType, false);
+    glBindVertexArray(lodVAO);
+    setParticleAttributes(offset + lodOffset, lodN, hasDensity, hasType, true);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    uploadedCount = n;
+    uploadedStore = particles;
+    uploadedIndex = currentIndex;
+    uploadedHasType = hasType;
+}
+
+void Engine::renderSoftware()
+{
+    // Gleiche Matrizen und Uniforms wie renderParticles
+    mat4 projection = mat4::perspective(45.0f, 800.0f / 600.0f, 0.1f, cameraViewDistance);
+    mat4 viewMatrix = mat4::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
+
+    SoftwareRenderer::ParticleStyle style;
+    style.scale = (float)globalScale;
+    style.typeMask = visibleTypeMask();
+    style.colorSource = renderMode <= 5 ? 0 : 1;
+    style.colorMode = colorMode;
+    style.densityAv = (float)densityAv;
+    style.alpha = particleAlpha;
+    style.pointSize = 0.5f;
+
+    static const std::vector<SoftwareRenderer::Point> noStars;
+    softwareRenderer.render(projection, viewMatrix, BGstars ? softwareStars : noStars, particles, style);
+}
+
+bool Engine::LayerState::operator==(const LayerState& other) const
+{
+    return store == other.store && index == other.index && std::equal(camera, camera + 9, other.camera)
+        && scale == other.scale && alpha == other.alpha && densityAv == other.densityAv && lodPixelSize == other.lodPixelSize
+        && colorMode == other.colorMode && width == other.width && height == other.height;
+}
+
+bool Engine::createLayerTargets(int targetWidth, int targetHeight)
+{
+    if (layerTexture == 0) glGenTextures(1, &layerTexture);
+    if (layerFramebuffer == 0) glGenFramebuffers(1, &layerFramebuffer);
+
+    // Halbe Floats reichen: unter 1 ist die Auflösung viel feiner als die 8 Bit der Ausgabe,
+    // über 1 ist der Pixel ohnehin gesättigt
+    glBindTexture(GL_TEXTURE_2D_ARRAY, layerTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA16F, targetWidth, targetHeight, ParticleStore::NUM_TYPES, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, layerFramebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, layerTexture, 0, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Layer framebuffer incomplete: " << status << std::endl;
+        return false;
     }
-    return color;
+
+    layerWidth = targetWidth;
+    layerHeight = targetHeight;
+    std::fill(layerValid, layerValid + ParticleStore::NUM_TYPES, false);
+    return true;
 }
 
+void Engine::renderLayer(int type, const float viewProjection[16], const mat4& projection)
+{
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, layerTexture, 0, type);
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+    glBindVertexArray(VAO);
+    const ParticleOctree* octree = uploadedStore && !uploadedStore->octree.empty() ? &uploadedStore->octree : nullptr;
+    if (octree)
+    {
+        // Nur der Baum dieses Typs und davon die Knoten im Sichtfeld, Knoten unter lodPixelSize Pixeln als Aggregate
+        const float eye[3] = { (float)(cameraPosition.x / globalScale), (float)(cameraPosition.y / globalScale), (float)(cameraPosition.z / globalScale) };
+        // Pixel pro Einheit in Abstand eins: 1 / tan(fovy / 2) auf die halbe Bildhöhe
+        float pixelsPerUnit = lodPixelSize > 0.0f ? std::fabs(projection.data()[5]) * layerHeight * 0.5f : 0.0f;
+        octree->select(viewProjection, (float)globalScale, eye, pixelsPerUnit, lodPixelSize, 1u << type, selection);
+
+        if (!selection.particleFirst.empty())
+        {
+            glMultiDrawArrays(GL_POINTS, selection.particleFirst.data(), selection.particleCount.data(), (GLsizei)selection.particleFirst.size());
+        }
+        if (!selection.lodFirst.empty())
+        {
+            glBindVertexArray(lodVAO);
+            glMultiDrawArrays(GL_POINTS, selection.lodFirst.data(), selection.lodCount.data(), (GLsizei)selection.lodFirst.size());
+        }
+    }
+    else
+    {
+        // Nur Stores, die nicht vom Loader kommen, haben keinen Octree, sie landen ganz in Layer 0
+        glDrawArrays(GL_POINTS, 0, (GLsizei)uploadedCount);
+    }
+    layerValid[type] = true;
+}
 
 void Engine::renderParticles()
 {
-    // Binden des Framebuffers
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Binden des Framebuffers (headless das Offscreen-FBO, sonst 0)
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Deaktivieren Sie den Tiefentest und das Z-Buffering
     glDisable(GL_DEPTH_TEST);
     glDepthMask(GL_FALSE);
 
-    // In der renderParticles-Funktion
-    glUseProgram(shaderProgram);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
-
     // Erstellen der Projektionsmatrix und Sichtmatrix
     mat4 projection = mat4::perspective(45.0f, 800.0f / 600.0f, 0.1f, cameraViewDistance);
     mat4 viewMatrix = mat4::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
 
-    // Setzen der Matrizen im Shader
-    GLuint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    GLuint viewLoc = glGetUniformLocation(shaderProgram, "view");
-
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, projection.data());
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, viewMatrix.data());
-
     // Vertex Array Object (VAO) binden
     glBindVertexArray(VAO);
 
-    if (BGstars)
+    // Nur neu hochladen, wenn sich der Snapshot geändert hat. Render-Modus,
+    // Colormap und Dichte-Mittelwert sind Uniforms
+    if (particles != uploadedStore || currentIndex != uploadedIndex || particleBuffer.id() == 0)
     {
-        //render the background bgStars
-        for (int i = 0; i < amountOfStars; i++)
-        {
-            glPointSize(bgStars[i].size);
-
-            // Setzen der Position im Shader
-            vec3 pos(bgStars[i].position);
-            float posArray[3];
-            pos.toFloatArray(posArray);
-            glUniform3fv(glGetUniformLocation(shaderProgram, "particlePosition"), 1, posArray);
-
-            // Setzen der Farbe im Shader
-            vec3 color(bgStars[i].color);
-            float colorArray[3];
-            color.toFloatArray(colorArray);
-            float starAlpha = bgStars[i].alpha;  // Transparenz aus Engine-Variable
-            glUniform1f(glGetUniformLocation(shaderProgram, "alpha"), starAlpha);
-            glUniform3fv(glGetUniformLocation(shaderProgram, "particleColor"), 1, colorArray);
-
-            // Zeichnen des Punktes
-            glDrawArrays(GL_POINTS, 0, 1);
-        }
+        uploadParticles();
     }
 
-    for (const auto& particle : *particles)
+    if (BGstars && starCount > 0)
     {
-        if(particle->type == 3 && (renderMode == 2 || renderMode == 3 || renderMode == 4 || renderMode == 7 || renderMode == 8 || renderMode == 9))
-        {
-            continue;
-        } 
-        if (particle->type == 2 && (renderMode == 3 || renderMode == 5 || renderMode == 8 || renderMode == 10))
-        {
-            continue;
-        }
-        if(particle->type == 1 && (renderMode == 5 || renderMode == 4 || renderMode == 9 || renderMode == 10))
-        {
-            continue;
-        }
+        // Hintergrundsterne liegen fertig im statischen Buffer, Größe kommt aus gl_PointSize
+        glUseProgram(starProgram);
+        glUniformMatrix4fv(glGetUniformLocation(starProgram, "projection"), 1, GL_FALSE, projection.data());
+        glUniformMatrix4fv(glGetUniformLocation(starProgram, "view"), 1, GL_FALSE, viewMatrix.data());
+        glBindVertexArray(starVAO);
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glDrawArrays(GL_POINTS, 0, starCount);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
 
-        double red = 1;
-        double green = 1;
-        double blue = 1;
+    // Jeder Typ hat seinen eigenen Layer. Die Layer bleiben gültig, solange sich Kamera,
+    // Zeitschritt und Darstellung nicht ändern, ein Wechsel des Render-Modus setzt nur neu zusammen
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    LayerState state;
+    state.store = uploadedStore;
+    state.index = uploadedIndex;
+    const vec3 cameraVectorList[3] = { cameraPosition, cameraFront, cameraUp };
+    for (int k = 0; k < 3; k++)
+    {
+        state.camera[3 * k] = cameraVectorList[k].x;
+        state.camera[3 * k + 1] = cameraVectorList[k].y;
+        state.camera[3 * k + 2] = cameraVectorList[k].z;
+    }
+    state.scale = (float)globalScale;
+    state.alpha = particleAlpha;
+    state.densityAv = (float)densityAv;
+    state.lodPixelSize = lodPixelSize;
+    state.colorMode = colorMode;
+    state.width = viewport[2];
+    state.height = viewport[3];
+
+    if ((layerWidth != viewport[2] || layerHeight != viewport[3]) && !createLayerTargets(viewport[2], viewport[3]))
+    {
+        return;
+    }
+    if (!(state == layerState))
+    {
+        std::fill(layerValid, layerValid + ParticleStore::NUM_TYPES, false);
+        layerState = state;
+    }
 
-        vec3 color = vec3(red, green, blue);
-        if(renderMode <= 5)
+    // Sichtbare Typen mit Partikeln, ohne Typbereiche liegt alles in Layer 0
+    uint32_t layerMask = 0;
+    const uint32_t typeMask = uploadedHasType ? visibleTypeMask() : 0xFFFFFFFFu;
+    if (uploadedStore && uploadedStore->typesGrouped && !uploadedStore->octree.empty())
+    {
+        for (int type = 0; type < ParticleStore::NUM_TYPES; type++)
         {
-            color = agColorMap(particle.get(), densityAv);
+            if ((typeMask & (1u << type)) && uploadedStore->typeBegin[type + 1] > uploadedStore->typeBegin[type]) layerMask |= 1u << type;
         }
-        else
+    }
+    else if (uploadedCount > 0)
+    {
+        layerMask = 1;
+    }
+
+    bool missing = false;
+    for (int type = 0; type < ParticleStore::NUM_TYPES; type++)
+    {
+        if ((layerMask & (1u << type)) && !layerValid[type]) missing = true;
+    }
+    if (missing)
+    {
+        // Fehlende Layer rendern: vormultiplizierte Farbe und Summe von alpha, beides additiv in Float
+        float viewProjection[16];
+        const float* p = projection.data();
+        const float* v = viewMatrix.data();
+        for (int col = 0; col < 4; col++)
         {
-            if(particle->type == 1)
-            {
-                color = vec3(1, 0, 0);
-            }
-            if(particle->type == 2)
-            {
-                color = vec3(0, 1, 0);
-            }
-            if(particle->type == 3)
+            for (int row = 0; row < 4; row++)
             {
-                color = vec3(0, 0, 1);
+                viewProjection[4 * col + row] = p[row] * v[4 * col] + p[4 + row] * v[4 * col + 1] + p[8 + row] * v[4 * col + 2] + p[12 + row] * v[4 * col + 3];
             }
         }
 
-        vec3 scaledPosition = particle->position * globalScale;
-
-        // Setzen Position im Shader
-        float scaledPosArray[3];
-        scaledPosition.toFloatArray(scaledPosArray);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "particlePosition"), 1, scaledPosArray);
-
-        // Setzen Farbe im Shader
-        float colorArray[3];
-        color.toFloatArray(colorArray);
-        float alpha = particleAlpha;  // Transparenz aus Engine-Variable
-        glUniform1f(glGetUniformLocation(shaderProgram, "alpha"), alpha);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "particleColor"), 1, colorArray);
-        
-        glPointSize(0.5f); // Setzen der Punktgröße auf 5 Pixel
+        glUseProgram(shaderProgram);
+        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection.data());
+        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, viewMatrix.data());
+        glUniform1f(glGetUniformLocation(shaderProgram, "scale"), (float)globalScale);
+        glUniform1f(glGetUniformLocation(shaderProgram, "alpha"), particleAlpha);
+        glUniform1i(glGetUniformLocation(shaderProgram, "colorMode"), colorMode);
+        glUniform1f(glGetUniformLocation(shaderProgram, "densityAv"), (float)densityAv);
+        glUniform1i(glGetUniformLocation(shaderProgram, "colorMap"), 0);
+        colorMaps.bind(colorMode, 0);
+        glVertexAttrib1f(3, 0.0f);
+        glVertexAttribI1ui(4, 0);
+        glVertexAttrib1f(5, 1.0f);
+        glPointSize(0.5f);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, layerFramebuffer);
+        for (int type = 0; type < ParticleStore::NUM_TYPES; type++)
+        {
+            if ((layerMask & (1u << type)) && !layerValid[type]) renderLayer(type, viewProjection, projection);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
 
-        // Zeichnen Punkt
-        glDrawArrays(GL_POINTS, 0, 1);
+        // Die Region darf erst wieder beschrieben werden, wenn die GPU damit fertig ist
+        particleBuffer.fence();
     }
 
+    // Layer des Modus über die Sterne addieren, in Dichte- oder Typfarben
+    glUseProgram(compositeProgram);
+    glUniform1ui(glGetUniformLocation(compositeProgram, "layerMask"), layerMask);
+    glUniform1i(glGetUniformLocation(compositeProgram, "colorSource"), renderMode <= 5 ? 0 : 1);
+    glUniform1i(glGetUniformLocation(compositeProgram, "layers"), 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, layerTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(compositeVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
     // VAO lösen
     glBindVertexArray(0);
 }
@@ -173,7 +384,7 @@ void printMatrix(const mat4& matrix) {
     }
 }
 
-Engine::Engine(std::string NewDataFolder, double deltaTime, double numOfParticles, double numTimeSteps, std::vector<std::shared_ptr<Particle>>* particles) : window(nullptr), shaderProgram(0), VAO(0)
+Engine::Engine(std::string NewDataFolder, double deltaTime, double numOfParticles, double numTimeSteps, ParticleStore* particles) : window(nullptr), shaderProgram(0), VAO(0)
 {
     dataFolder = NewDataFolder;
     this->deltaTime = deltaTime;
@@ -187,21 +398,11 @@ Engine::Engine(std::string NewDataFolder, double deltaTime, double numOfParticle
     cameraUp = vec3(0.0, 1.0, 0.0);
     cameraYaw = -90.0f;
     cameraPitch = 0.0f;
-
-    saveThread = std::thread(&Engine::saveWorker, this);
 }
 
 Engine::~Engine() {
-    // Terminate the save worker thread
-    {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        terminateThread = true;
-        queueCondition.notify_all();
-    }
-    saveThread.join();
-    if (pbo != 0) {
-        glDeleteBuffers(1, &pbo);
-    }
+    // Der Encoder schreibt beim Zerstören noch alle ausstehenden Bilder
+    frameEncoder.reset();
 }
 
 void glfw_error_callback(int error, const char* description)
@@ -245,44 +446,83 @@ bool Engine::init(double physicsFaktor)
 {
     faktor = physicsFaktor;
 
-    // GLFW initialisieren
-    glfwSetErrorCallback(glfw_error_callback);
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
+    // Den Stream vor dem Rendern öffnen, damit ein falscher Pfad sofort auffällt
+    if (!RenderLive && FrameEncoderPool::isStreamFormat(videoFormat) && !frameEncoder && !openFrameEncoder())
+    {
         return false;
     }
 
-    // OpenGL-Version und -Profil setzen
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1); // Passe hier an, falls nötig
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_DEPTH_BITS, 24); // Tiefenpuffer
-
-    // Fenster erstellen
-    int width_Window = 1200;
-    int height_Window = 800;
-    if (!RenderLive) {
-        width_Window = 1920;
-        height_Window = 1080;
+    if (renderBackend == SOFTWARE_BACKEND)
+    {
+        // Kein GL-Kontext, der Splatter rendert direkt in ein Bild der Videogröße
+        if (RenderLive)
+        {
+            std::cerr << "Software rendering only works for videos" << std::endl;
+            return false;
+        }
+        headless = true;
+        softwareRenderer.threadPool = threadPool;
+        softwareRenderer.resize(videoWidth, videoHeight);
+        std::cout << "Width: " << videoWidth << ", Height: " << videoHeight << std::endl;
+        std::cout << "Renderer: CPU splatter (" << (threadPool ? threadPool->size() : 1) << " threads, " << projectionKernelName() << ")" << std::endl;
+        return true;
     }
-    window = glfwCreateWindow(width_Window, height_Window, "Particle Rendering", nullptr, nullptr);
-    if (!window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return false;
+
+    int width, height;
+    if (headless)
+    {
+        // Ohne Fenster: EGL-Kontext, gerendert wird in ein FBO der Videogröße
+        if (RenderLive)
+        {
+            std::cerr << "Headless rendering only works for videos" << std::endl;
+            return false;
+        }
+        if (!headlessContext.create(4, 1))
+        {
+            return false;
+        }
+        width = videoWidth;
+        height = videoHeight;
     }
+    else
+    {
+        // GLFW initialisieren
+        glfwSetErrorCallback(glfw_error_callback);
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW" << std::endl;
+            return false;
+        }
 
-    // Kontext binden
-    glfwMakeContextCurrent(window);
+        // OpenGL-Version und -Profil setzen
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1); // Passe hier an, falls nötig
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_DEPTH_BITS, 24); // Tiefenpuffer
+
+        // Fenster erstellen
+        int width_Window = 1200;
+        int height_Window = 800;
+        if (!RenderLive) {
+            width_Window = videoWidth;
+            height_Window = videoHeight;
+        }
+        window = glfwCreateWindow(width_Window, height_Window, "Particle Rendering", nullptr, nullptr);
+        if (!window) {
+            std::cerr << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return false;
+        }
 
+        // Kontext binden
+        glfwMakeContextCurrent(window);
 
-    // Breite und Höhe des Framebuffers holen
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
+        // Breite und Höhe des Framebuffers holen
+        glfwGetFramebufferSize(window, &width, &height);
 
-    // Fallback für ungültige Breite oder Höhe
-    if (width == 0) width = 800;
-    if (height == 0) height = 600;
+        // Fallback für ungültige Breite oder Höhe
+        if (width == 0) width = 800;
+        if (height == 0) height = 600;
+    }
 
     std::cout << "Width: " << width << ", Height: " << height << std::endl;
 
@@ -296,6 +536,8 @@ bool Engine::init(double physicsFaktor)
     // GLEW initialisieren
     glewExperimental = GL_TRUE;
     GLenum err = glewInit();
+    // Ohne X-Display schlägt nur der GLX-Teil fehl, die GL-Funktionen sind dann schon geladen
+    if (headless && err == GLEW_ERROR_NO_GLX_DISPLAY) err = GLEW_OK;
     if (err != GLEW_OK) {
         std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(err) << std::endl;
         return false;
@@ -320,8 +562,14 @@ bool Engine::init(double physicsFaktor)
     // Tiefentest aktivieren
     glEnable(GL_DEPTH_TEST);
 
+    // Headless gibt es keinen Standard-Framebuffer
+    if (headless && !createOffscreenTarget(width, height))
+    {
+        return false;
+    }
+
     // Framebuffer prüfen
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
     GLenum framebufferStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (framebufferStatus != GL_FRAMEBUFFER_COMPLETE) {
         std::cerr << "Framebuffer incomplete: " << framebufferStatus << std::endl;
@@ -329,44 +577,116 @@ bool Engine::init(double physicsFaktor)
     }
 
     // Shader erstellen und aktivieren
+    // Position (als drei Spalten), Dichte und Typ kommen pro Partikel als Vertex-Attribute,
+    // die Farbe wird hier aus Dichte und Colormap berechnet
     const char* vertexShaderSource = R"(
         #version 410 core
+        layout(location = 0) in float positionX;
+        layout(location = 1) in float positionY;
+        layout(location = 2) in float positionZ;
+        layout(location = 3) in float density;
+        layout(location = 4) in uint particleType;
+        layout(location = 5) in float weight;      // Anzahl Partikel eines Octree-Aggregats, sonst 1
         uniform mat4 projection;
         uniform mat4 view;
-        uniform vec3 particlePosition;
+        uniform float scale;
+        uniform int colorMode;     // ColorMap::GALACTIC wird berechnet, die anderen aus colorMap gelesen
+        uniform float densityAv;
+        uniform sampler1D colorMap;
+        out vec3 color;
+        out float lodWeight;
+
+        vec3 galacticColor(float d, uint type) {
+            if (densityAv == 0.0) return vec3(0.0);
+            float ratio = d / densityAv;
+            vec3 c = vec3(ratio, 0.0, d > 0.0 ? densityAv * 2.0 / d : 1.0);
+            float plus = ratio * 100.0 > 1.0 ? ratio / 10.0 : 0.0;
+            if (type == 2u) plus *= 4.0;
+            c += vec3(plus * 10.0 + 0.2, plus - 0.2, plus + 0.2);
+            return clamp(c, 0.0, 1.0);
+        }
+
+        vec3 particleColor() {
+            if (colorMode == 2) return galacticColor(density, particleType);
+            // Logarithmisch um den Mittelwert: 1/100 bis 100-fache Dichte
+            float t = 0.0;
+            if (densityAv > 0.0 && density > 0.0) t = clamp(0.5 + 0.25 * log(density / densityAv) / log(10.0), 0.0, 1.0);
+            return textureLod(colorMap, t, 0.0).rgb;
+        }
+
         void main() {
-            gl_Position = projection * view * vec4(particlePosition, 1.0);
-            gl_PointSize = 10.0;
+            color = particleColor();
+            lodWeight = weight;
+            gl_Position = projection * view * vec4(vec3(positionX, positionY, positionZ) * scale, 1.0);
         }
     )";
     const char* fragmentShaderSource = R"(
         #version 410 core
+        in vec3 color;
+        in float lodWeight;
         out vec4 FragColor;
-        uniform vec3 particleColor;
-        uniform float alpha;  // <- NEU
+        uniform float alpha;
         void main() {
-            FragColor = vec4(particleColor, alpha);
+            // Vormultipliziert in den Float-Layer, a = Summe von alpha für die Typfarben.
+            // Ein Aggregat steht für lodWeight Punkte
+            float a = alpha * lodWeight;
+            FragColor = vec4(color * a, a);
         }
     )";
 
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    glCompileShader(vertexShader);
-    checkShaderCompileStatus(vertexShader, "VERTEX");
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-    glCompileShader(fragmentShader);
-    checkShaderCompileStatus(fragmentShader, "FRAGMENT");
+    shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
 
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    checkShaderLinkStatus(shaderProgram);
+    // Hintergrundsterne: Position, Größe und Farbe pro Vertex, ohne Skalierung
+    const char* starVertexShaderSource = R"(
+        #version 410 core
+        layout(location = 0) in vec3 position;
+        layout(location = 1) in float size;
+        layout(location = 2) in vec4 starColor;
+        uniform mat4 projection;
+        uniform mat4 view;
+        out vec4 color;
+        void main() {
+            color = starColor;
+            gl_PointSize = size;
+            gl_Position = projection * view * vec4(position, 1.0);
+        }
+    )";
+    const char* starFragmentShaderSource = R"(
+        #version 410 core
+        in vec4 color;
+        out vec4 FragColor;
+        void main() {
+            FragColor = color;
+        }
+    )";
+    starProgram = createShaderProgram(starVertexShaderSource, starFragmentShaderSource);
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Zusammensetzen der Typ-Layer: ein bildschirmfüllendes Dreieck ohne Vertex-Daten
+    const char* compositeVertexShaderSource = R"(
+        #version 410 core
+        void main() {
+            vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+            gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+        }
+    )";
+    const char* compositeFragmentShaderSource = R"(
+        #version 410 core
+        uniform sampler2DArray layers;
+        uniform uint layerMask;    // Bit t = Layer von Typ t wird addiert
+        uniform int colorSource;   // 0 = Dichte mit Colormap, 1 = Farbe nach Typ
+        out vec4 FragColor;
+        const vec3 typeColors[4] = vec3[4](vec3(1.0), vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0));
+        void main() {
+            vec3 sum = vec3(0.0);
+            for (int type = 0; type < 4; type++) {
+                if ((layerMask & (1u << uint(type))) == 0u) continue;
+                vec4 layer = texelFetch(layers, ivec3(ivec2(gl_FragCoord.xy), type), 0);
+                sum += colorSource == 1 ? typeColors[type] * layer.a : layer.rgb;
+            }
+            FragColor = vec4(sum, 1.0);
+        }
+    )";
+    compositeProgram = createShaderProgram(compositeVertexShaderSource, compositeFragmentShaderSource);
 
     // Shader aktivieren
     glUseProgram(shaderProgram);
@@ -374,16 +694,13 @@ bool Engine::init(double physicsFaktor)
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
 
-    // VAO und VBO erstellen
+    // VAOs für die Partikel und die Octree-Aggregate, die Buffer werden beim ersten Zeichnen angelegt
     glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    glGenVertexArrays(1, &lodVAO);
+    glGenVertexArrays(1, &compositeVAO);
 
-    GLuint VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
-
-    glBindVertexArray(0);
+    // Colormap-Texturen
+    colorMaps.init();
 
     // Uniform-Locations überprüfen
     GLuint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
@@ -394,6 +711,9 @@ bool Engine::init(double physicsFaktor)
     }
 
     // Cursor-Modus setzen
+    if (headless) {
+        return true;
+    }
     if (RenderLive) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     } else {
@@ -415,12 +735,6 @@ bool Engine::init(double physicsFaktor)
 
 void Engine::start()
 {
-    // Entfernen Sie die VBO-Erstellung und -Konfiguration, da wir keine Vertex-Attribute verwenden
-
-    // Erstellen und Binden eines leeren VAO
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
     // Wenn Sie Hintergrundsterne haben, können Sie diesen Code beibehalten
     if (BGstars)
     {
@@ -442,76 +756,271 @@ void Engine::start()
             vec3 color(r, g, b);
             bgStars.push_back({ vec3(x, y, z), size, color, starAlpha });
         }
+        if (renderBackend == SOFTWARE_BACKEND)
+        {
+            for (const bgStar& star : bgStars)
+            {
+                softwareStars.push_back({ (float)star.position.x, (float)star.position.y, (float)star.position.z, (float)star.size,
+                    (float)star.color.x, (float)star.color.y, (float)star.color.z, (float)star.alpha });
+            }
+        }
+        else
+        {
+            uploadStars();
+        }
     }
 
     std::cout << "Data loaded" << std::endl;
 }
 
 
-void Engine::initializePBO() {
-    if (pbo == 0) {
-        glGenBuffers(1, &pbo);
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
-        glBufferData(GL_PIXEL_PACK_BUFFER, 3 * width * height, nullptr, GL_STREAM_READ);
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+void Engine::uploadStars()
+{
+    // Die Sterne ändern sich nach start() nicht mehr, einmal in einen statischen Buffer
+    std::vector<float> vertices;
+    vertices.reserve(bgStars.size() * 8);
+    for (const bgStar& star : bgStars)
+    {
+        vertices.push_back((float)star.position.x);
+        vertices.push_back((float)star.position.y);
+        vertices.push_back((float)star.position.z);
+        vertices.push_back((float)star.size);
+        vertices.push_back((float)star.color.x);
+        vertices.push_back((float)star.color.y);
+        vertices.push_back((float)star.color.z);
+        vertices.push_back((float)star.alpha);
     }
+
+    if (starVAO == 0) glGenVertexArrays(1, &starVAO);
+    if (starVBO == 0) glGenBuffers(1, &starVBO);
+    glBindVertexArray(starVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, starVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+    const GLsizei stride = 8 * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (const void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(4 * sizeof(float)));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    starCount = (GLsizei)bgStars.size();
+}
+
+bool Engine::createOffscreenTarget(int targetWidth, int targetHeight)
+{
+    glGenFramebuffers(1, &offscreenFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+
+    glGenRenderbuffers(1, &offscreenColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, targetWidth, targetHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColor);
+
+    glGenRenderbuffers(1, &offscreenDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, targetWidth, targetHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreenDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Offscreen framebuffer incomplete: " << status << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Engine::initializePBO(int width, int height) {
+    releasePBO();
+    glGenBuffers(PBO_COUNT, pbos);
+    for (int i = 0; i < PBO_COUNT; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)3 * width * height, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pboWidth = width;
+    pboHeight = height;
+}
+
+void Engine::releasePBO() {
+    for (int i = 0; i < PBO_COUNT; i++)
+    {
+        if (pboFences[i]) glDeleteSync(pboFences[i]);
+        pboFences[i] = 0;
+    }
+    if (pbos[0] != 0) glDeleteBuffers(PBO_COUNT, pbos);
+    std::fill(pbos, pbos + PBO_COUNT, 0);
+    pboWidth = 0;
+    pboHeight = 0;
+    pboNext = 0;
+    pboPending = 0;
 }
 
 void Engine::saveAsPicture(const std::string& folderName, int index) {
     // Speichern Sie das gerenderte Bild als BMP-Datei
-    glfwGetFramebufferSize(window, &width, &height);
+    if (headless)
+    {
+        width = videoWidth;
+        height = videoHeight;
+    }
+    else
+    {
+        glfwGetFramebufferSize(window, &width, &height);
+    }
 
-    // Initialize PBO if not already initialized
-    initializePBO();
+    if (!frameEncoder && !openFrameEncoder())
+    {
+        return;
+    }
 
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
-    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    // Beim Stream zählt nur die Reihenfolge, einen Dateinamen gibt es nur für Bilder
+    std::string filename = pictureFilename(index);
+    if (!filename.empty())
+    {
+        std::filesystem::create_directory("../Video_Output/" + videoName + "/");
+    }
 
-    // Map the PBO to process its data on the CPU
-    unsigned char* data = (unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (renderBackend == SOFTWARE_BACKEND)
+    {
+        // Liegt schon im Speicher, gleiche Zeilenreihenfolge wie glReadPixels.
+        // acquire blockiert, solange alle Frames beim Encoder liegen
+        std::unique_ptr<FrameEncoderPool::Frame> frame = frameEncoder->acquire();
+        frame->filename = filename;
+        frame->width = width;
+        frame->height = height;
+        frame->pixels.assign(softwareRenderer.pixels().begin(), softwareRenderer.pixels().end());
+        frameEncoder->submit(std::move(frame));
+        return;
+    }
 
-    // Copy data to a vector to pass to the saving thread
-    std::vector<unsigned char> imageData(data, data + 3 * width * height);
+    if (width != pboWidth || height != pboHeight)
+    {
+        // Neue Größe: laufende Readbacks noch mit den alten Buffern abholen
+        finishPictures();
+        initializePBO(width, height);
+    }
 
-    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    // Readback nur anstoßen, die Kopie läuft asynchron in den PBO
+    const int slot = pboNext;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, offscreenFramebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pboFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pboFilenames[slot] = filename;
+    pboNext = (slot + 1) % PBO_COUNT;
+    pboPending++;
+
+    // Erst wenn alle Slots belegt sind, den ältesten abholen
+    if (pboPending == PBO_COUNT)
+    {
+        readPicture();
+    }
+}
+
+void Engine::readPicture() {
+    if (pboPending == 0) return;
+    const int slot = (pboNext - pboPending + PBO_COUNT) % PBO_COUNT;
 
-    // Umkehren der Pixelreihenfolge in-place
-    for (int y = 0; y < height / 2; y++) {
-        for (int x = 0; x < 3 * width; x++) {
-            std::swap(imageData[3 * width * y + x], imageData[3 * width * (height - 1 - y) + x]);
+    // Normalerweise längst signalisiert, sonst bis zu einer Sekunde warten
+    if (pboFences[slot])
+    {
+        GLenum result = glClientWaitSync(pboFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+        {
+            std::cerr << "Waiting for frame readback failed: " << result << std::endl;
         }
+        glDeleteSync(pboFences[slot]);
+        pboFences[slot] = 0;
     }
 
-    std::string fullPath = "../Video_Output/" + videoName + "/";
-    std::filesystem::create_directory(fullPath);
+    // Wartet, falls der Encoder hinterherhängt, damit der Speicher begrenzt bleibt
+    std::unique_ptr<FrameEncoderPool::Frame> frame = frameEncoder->acquire();
+    frame->filename = std::move(pboFilenames[slot]);
+    frame->width = pboWidth;
+    frame->height = pboHeight;
+    const size_t size = (size_t)3 * pboWidth * pboHeight;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    const unsigned char* data = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    bool mapped = data != nullptr;
+    if (mapped)
+    {
+        frame->pixels.assign(data, data + size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+    {
+        std::cerr << "Could not map frame readback for " << frame->filename << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pboPending--;
 
-    std::string filename = fullPath + "Picture_" + std::to_string(index) + ".bmp";
+    if (mapped)
+    {
+        frameEncoder->submit(std::move(frame));
+    }
+    else
+    {
+        frameEncoder->release(std::move(frame));
+    }
+}
 
-    // Add the data to the save queue
+bool Engine::openFrameEncoder() {
+    frameEncoder.reset(new FrameEncoderPool(encoderThreads));
+    frameEncoder->threadPool = threadPool;
+    bool opened = FrameEncoderPool::isStreamFormat(videoFormat)
+        ? frameEncoder->openStream(videoOutput, videoFormat, videoFrameRate)
+        : frameEncoder->setImageFormat(videoFormat);
+    if (!opened)
     {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        saveQueue.emplace(filename, std::move(imageData));
-        queueCondition.notify_one();
+        frameEncoder.reset();
+        return false;
     }
+    return true;
 }
 
-void Engine::saveWorker() {
-    while (true) {
-        std::pair<std::string, std::vector<unsigned char>> item;
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            queueCondition.wait(lock, [this] { return !saveQueue.empty() || terminateThread; });
+std::string Engine::pictureFilename(int index) const {
+    if (FrameEncoderPool::isStreamFormat(videoFormat))
+    {
+        return std::string();
+    }
+    return "../Video_Output/" + videoName + "/Picture_" + std::to_string(index) + FrameEncoderPool::fileExtension(videoFormat);
+}
 
-            if (terminateThread && saveQueue.empty()) {
-                break;
-            }
+bool Engine::pictureExists(int index) const {
+    std::string filename = pictureFilename(index);
+    std::error_code error;
+    if (filename.empty() || !std::filesystem::is_regular_file(filename, error))
+    {
+        return false;
+    }
 
-            item = std::move(saveQueue.front());
-            saveQueue.pop();
-        }
+    // Nur Bilder in der Größe, die saveAsPicture jetzt schreiben würde, zählen als fertig.
+    // Andere Dateien stammen von einem Lauf mit anderen Einstellungen und werden überschrieben
+    int frameWidth = videoWidth;
+    int frameHeight = videoHeight;
+    if (!headless)
+    {
+        glfwGetFramebufferSize(window, &frameWidth, &frameHeight);
+    }
+    int pictureWidth = 0;
+    int pictureHeight = 0;
+    return FrameEncoderPool::readImageSize(filename, pictureWidth, pictureHeight)
+        && pictureWidth == frameWidth && pictureHeight == frameHeight;
+}
 
-        stbi_write_bmp(item.first.c_str(), width, height, 3, item.second.data());
+void Engine::finishPictures() {
+    while (pboPending > 0)
+    {
+        readPicture();
     }
 }
 
@@ -523,7 +1032,14 @@ void Engine::window_iconify_callback(GLFWwindow* window, int iconified) {
 
 void Engine::update(int index)
 {
-    if(index == 0)
+    currentIndex = index;
+
+    // Ohne Dichte geladene Snapshots liefern 0, dann beim Wechsel des Render-Modus nachholen
+    if (index == 0)
+    {
+        calibrate();
+    }
+    else if (densityAv == 0 && particles && particles->hasFields(ParticleStore::Density))
     {
         densityAv = calcDensityAv();
     }
@@ -556,22 +1072,27 @@ void Engine::update(int index)
     if(isRunning && RenderLive == false) processInput();
     if (RenderLive) processInput();
 
-    // set the globalScale of the system
-    if (index == 0)
+    if (renderBackend == SOFTWARE_BACKEND)
     {
-        calculateGlobalScale();
+        renderSoftware();
+    }
+    else
+    {
+        renderParticles();
     }
 
-    renderParticles();
-
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    if (!headless)
+    {
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
 
-    //if video is rendered
+    //if video is rendered (Zeitschritt 0 wird nie gespeichert, renderVideo überspringt ihn)
     if (RenderLive == false && index != oldIndex && index != 0)
     {
         saveAsPicture(dataFolder, index);
-        glfwSetWindowIconifyCallback(window, window_iconify_callback);
+        // Ein minimiertes Fenster würde das Rendern anhalten
+        if (!headless) glfwSetWindowIconifyCallback(window, window_iconify_callback);
     }
 
     if(RenderLive == true)
@@ -595,6 +1116,7 @@ void Engine::update(int index)
             playSpeed = playSpeed - changeSpeed;
         }
 
+    #ifdef WIN32
     if (GetAsyncKeyState(49) & 0x8000) renderMode = 1;
     if (GetAsyncKeyState(50) & 0x8000) renderMode = 2;
     if (GetAsyncKeyState(51) & 0x8000) renderMode = 3;
@@ -605,34 +1127,42 @@ void Engine::update(int index)
     if (GetAsyncKeyState(56) & 0x8000) renderMode = 8;
     if (GetAsyncKeyState(57) & 0x8000) renderMode = 9;
     if (GetAsyncKeyState(48) & 0x8000) renderMode = 10;
+    #else
+    // Tasten 1-9 = Modus 1-9, 0 = Modus 10
+    for (int key = 0; key <= 9; key++)
+    {
+        if (glfwGetKey(window, GLFW_KEY_0 + key) == GLFW_PRESS) renderMode = key == 0 ? 10 : key;
+    }
+    #endif
     }
 
     oldIndex = index;
 }
 
+uint32_t Engine::requiredFields() const
+{
+    uint32_t fields = ParticleStore::Position | ParticleStore::Type;
+    if (renderMode <= 5)
+    {
+        fields |= ParticleStore::Density;
+    }
+    return fields;
+}
+
 double Engine::calcDensityAv()
 {
     //calc the middle value of the particles densities
+    if (particles == nullptr || particles->empty() || !particles->hasFields(ParticleStore::Density)) return 0;
     double densityAv = 0;
-    int c = 0;
-    for (const auto& particle : *particles)
+    const Column<float>& density = particles->density;
+    for (size_t i = 0; i < density.size(); i++)
     {
-        c++;
-        densityAv += particle->density;
+        densityAv += density[i];
     }
     densityAv = densityAv / particles->size();
     return densityAv;
 }
 
-vec3 jetColorMap(double value) 
-{
-    double r = value < 0.5 ? 0.0 : 2.0 * value - 1.0;
-    double g = value < 0.25 ? 0.0 : value < 0.75 ? 1.0 : 1.0 - 4.0 * (value - 0.75);
-    double b = value < 0.5 ? 1.0 : 1.0 - 2.0 * value;
-
-    return vec3(r, g, b);
-}
-
 mat4 perspective(float fovY, float aspect, float zNear, float zFar) {
     float tanHalfFovy = tan(fovY * M_PI / 180.0f / 2.0f);
 
@@ -675,6 +1205,21 @@ void Engine::processInput()
         // Aktualisieren des letzten Tastendruckzustands
         lKeyWasPressedLastFrame = lKeyPressed;
 
+        // Colormap mit "C" weiterschalten, kostet nur ein Uniform
+        static bool cKeyWasPressedLastFrame = false;
+        bool cKeyPressed =
+#ifdef WIN32
+        (GetAsyncKeyState('C') & 0x8000) != 0;
+#else
+            glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+#endif
+        if (cKeyPressed && !cKeyWasPressedLastFrame)
+        {
+            colorMode = colorMode >= ColorMap::LAST ? ColorMap::FIRST : colorMode + 1;
+            std::cout << "ColorMap: " << ColorMap::name(colorMode) << std::endl;
+        }
+        cKeyWasPressedLastFrame = cKeyPressed;
+
         if (RenderLive)
         {
 #ifdef WIN32
@@ -711,9 +1256,7 @@ void Engine::processInput()
     }
     if (RenderLive == false)
     {
-        float index = 0.1f; 
-        cameraPosition += cameraSpeed * index * cameraFront.cross(cameraUp);
-        //std::cout << "Camera Position: " << cameraPosition.x << " " << cameraPosition.y << " " << cameraPosition.z << std::endl;
+        setVideoCamera(currentIndex);
     }
 
     
@@ -726,8 +1269,47 @@ void Engine::processInput()
     view = mat4::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
 
     // Setzen der Matrizen im Shader
-    GLuint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view.data());
+    if (renderBackend == OPENGL_BACKEND)
+    {
+        GLuint viewLoc = glGetUniformLocation(shaderProgram, "view");
+        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view.data());
+    }
+}
+
+void Engine::setVideoCamera(int index)
+{
+    if (!orbitStarted)
+    {
+        orbitStartPosition = cameraPosition;
+        orbitStartFront = cameraFront;
+        orbitPosition = cameraPosition;
+        orbitFront = cameraFront;
+        orbitSteps = 0;
+        orbitStarted = true;
+    }
+
+    // Zeitschritt i zeigt die Kamera nach i + 1 Schritten. Rückwärts wird von vorne
+    // gerechnet, vorwärts ab dem letzten Schritt, beides mit denselben Rechenschritten
+    int steps = std::max(index, 0) + 1;
+    if (steps < orbitSteps)
+    {
+        orbitPosition = orbitStartPosition;
+        orbitFront = orbitStartFront;
+        orbitSteps = 0;
+    }
+    while (orbitSteps < steps)
+    {
+        const float stepFactor = 0.1f;
+        orbitPosition += cameraSpeed * stepFactor * orbitFront.cross(cameraUp);
+        if (focusedCamera)
+        {
+            orbitFront = (vec3(0, 0, 0) - orbitPosition).normalize();
+        }
+        orbitSteps++;
+    }
+
+    cameraPosition = orbitPosition;
+    cameraFront = orbitFront;
 }
 
 void Engine::processMouseInput()
@@ -797,10 +1379,71 @@ void Engine::checkShaderLinkStatus(GLuint program)
     }
 }
 
+GLuint Engine::createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource)
+{
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+    glCompileShader(vertexShader);
+    checkShaderCompileStatus(vertexShader, "VERTEX");
+
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
+    glCompileShader(fragmentShader);
+    checkShaderCompileStatus(fragmentShader, "FRAGMENT");
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    checkShaderLinkStatus(program);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
 bool Engine::clean()
 {
-    // Aufräumen und beenden
-    glfwTerminate();
+    // Aufräumen und beenden. Letzte Frames des Videos stecken noch im PBO-Ring
+    // oder beim Encoder, beim Software-Backend gibt es keine PBOs
+    finishPictures();
+    releasePBO();
+    if (frameEncoder) frameEncoder->flush();
+    if (renderBackend == SOFTWARE_BACKEND)
+    {
+        return true;
+    }
+    if (starVBO != 0) glDeleteBuffers(1, &starVBO);
+    if (starVAO != 0) glDeleteVertexArrays(1, &starVAO);
+    starVBO = 0;
+    starVAO = 0;
+    starCount = 0;
+    particleBuffer.release();
+    if (lodVAO != 0) glDeleteVertexArrays(1, &lodVAO);
+    if (compositeVAO != 0) glDeleteVertexArrays(1, &compositeVAO);
+    if (layerFramebuffer != 0) glDeleteFramebuffers(1, &layerFramebuffer);
+    if (layerTexture != 0) glDeleteTextures(1, &layerTexture);
+    lodVAO = 0;
+    compositeVAO = 0;
+    layerFramebuffer = 0;
+    layerTexture = 0;
+    layerWidth = 0;
+    layerHeight = 0;
+    colorMaps.release();
+    if (offscreenFramebuffer != 0) glDeleteFramebuffers(1, &offscreenFramebuffer);
+    if (offscreenColor != 0) glDeleteRenderbuffers(1, &offscreenColor);
+    if (offscreenDepth != 0) glDeleteRenderbuffers(1, &offscreenDepth);
+    offscreenFramebuffer = 0;
+    offscreenColor = 0;
+    offscreenDepth = 0;
+    if (headless)
+    {
+        headlessContext.destroy();
+    }
+    else
+    {
+        glfwTerminate();
+    }
     return true;
 }
 
@@ -886,22 +1529,37 @@ double Engine::random(double min, double max)
     return randomFloat;
 }
 
+void Engine::calibrate()
+{
+    densityAv = calcDensityAv();
+    calculateGlobalScale();
+}
+
 void Engine::calculateGlobalScale()
 {
-    double maxDistance = 0;
-    for (const auto& particle : *particles)
+    if (particles == nullptr)
     {
-        // Skip ungültige oder extreme Werte
-        if (particle->position.x == 0 && particle->position.y == 0 && particle->position.z == 0)
-            continue;
-        if (std::isinf(particle->position.x) || std::isinf(particle->position.y) || std::isinf(particle->position.z) ||
-            std::isnan(particle->position.x) || std::isnan(particle->position.y) || std::isnan(particle->position.z))
+        globalScale = 1;
+        return;
+    }
+
+    double maxDistance2 = 0;
+    const ParticleStore& store = *particles;
+    for (size_t i = 0; i < store.size(); i++)
+    {
+        double x = store.x[i];
+        double y = store.y[i];
+        double z = store.z[i];
+        double distance2 = x * x + y * y + z * z;
+
+        // Skip ungültige oder extreme Werte (Ursprung, inf, nan)
+        if (distance2 == 0 || !std::isfinite(distance2))
             continue;
 
-        double distance = sqrt(pow(particle->position.x, 2) + pow(particle->position.y, 2) + pow(particle->position.z, 2));
-        if (distance > maxDistance)
-            maxDistance = distance;
+        if (distance2 > maxDistance2)
+            maxDistance2 = distance2;
     }
+    double maxDistance = sqrt(maxDistance2);
 
     // Vermeide die Verarbeitung, wenn alle Positionen ungültig sind
     if (maxDistance == 0) {
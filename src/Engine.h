@@ -9,7 +9,13 @@
 #include "vec3.h"
 #include "mat4.h"
 #include "vec4.h"
-#include "Particle.h"
+#include "ParticleStore.h"
+#include "StreamBuffer.h"
+#include "ColorMap.h"
+#include "HeadlessContext.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+#include "FrameEncoderPool.h"
 #include <cmath>
 #include <queue>
 #include <mutex>
@@ -23,7 +29,7 @@
 
 class Engine {
 public:
-    Engine(std::string dataFolder, double deltaTime, double numOfParticles, double numTimeSteps, std::vector<std::shared_ptr<Particle>>* particles);
+    Engine(std::string dataFolder, double deltaTime, double numOfParticles, double numTimeSteps, ParticleStore* particles);
     ~Engine();
 
     float particleAlpha = 0.2f;
@@ -32,34 +38,66 @@ public:
     double numOfParticles;
     double numTimeSteps;
     
-    std::vector<std::shared_ptr<Particle>>* particles;
+    ParticleStore* particles;
 
     std::string dataFolder;
-    vec3 agColorMap(Particle* particle ,double densityAV);
-    vec3 jetColorMap(Particle* particle ,double densityAV);
     bool init(double physicsFaktor);
     void start();
     void update(int index);
     bool clean();
 
-    GLuint pbo = 0;
-    std::queue<std::pair<std::string, std::vector<unsigned char>>> saveQueue;
-    std::mutex queueMutex;
-    std::condition_variable queueCondition;
-    std::thread saveThread;
-    bool terminateThread = false;
-    int width, height;
+    // Ring aus PBOs: der Readback von Frame k wird erst bei Frame k + PBO_COUNT - 1 gemappt,
+    // bis dahin ist die GPU längst fertig und glMapBufferRange wartet nicht
+    static const int PBO_COUNT = 3;
+    GLuint pbos[PBO_COUNT] = {};
+    GLsync pboFences[PBO_COUNT] = {};
+    std::string pboFilenames[PBO_COUNT];
+    int pboWidth = 0, pboHeight = 0;
+    int pboNext = 0;      // Slot des nächsten Readbacks
+    int pboPending = 0;   // gestartete, noch nicht gemappte Readbacks
 
-    void initializePBO();
-    void saveWorker();
+    // Schreibt die Bilder des Videos, wird beim ersten Bild angelegt
+    std::unique_ptr<FrameEncoderPool> frameEncoder;
+    // Encoder-Threads, 0 = alle Hardware-Threads
+    unsigned int encoderThreads = 0;
+    // Ausgabe des Videos: ein Bild pro Frame (FrameEncoderPool::BMP_FORMAT, PNG_FORMAT,
+    // QOI_FORMAT) oder ein Stream (Y4M_FORMAT, RGB_FORMAT) nach videoOutput, "-" = stdout
+    int videoFormat = FrameEncoderPool::BMP_FORMAT;
+    std::string videoOutput;
+    int videoFrameRate = 30;
+    int width, height;
 
     void initializePBO(int width, int height);
+    void releasePBO();
     void saveAsPicture(const std::string& folderName, int index);
+    // Ältesten laufenden Readback mappen und in die Speicher-Queue legen
+    void readPicture();
+    // Alle laufenden Readbacks abholen, z.B. am Ende des Videos
+    void finishPictures();
+    bool openFrameEncoder();
+    // Dateiname des Bildes zum Zeitschritt index, leer bei Stream-Formaten
+    std::string pictureFilename(int index) const;
+    // Fertig geschriebenes Bild in der aktuellen Bildgröße vorhanden, halbe Dateien gibt es
+    // dank Umbenennen nicht
+    bool pictureExists(int index) const;
 
     static void window_iconify_callback(GLFWwindow* window, int iconified);
     bool RenderLive = true;
     std::string videoName;
 
+    // Video ohne Fenster über EGL und ein Offscreen-FBO (nur mit RenderLive = false)
+    bool headless = false;
+    int videoWidth = 1920;
+    int videoHeight = 1080;
+
+    // Render-Backend: OpenGL oder CPU-Splatter (ohne GPU und Fenster, nur für Videos)
+    static const int OPENGL_BACKEND = 0;
+    static const int SOFTWARE_BACKEND = 1;
+    int renderBackend = OPENGL_BACKEND;
+    // Threads des CPU-Splatters, ohne Pool rendert er auf dem aufrufenden Thread
+    ThreadPool* threadPool = nullptr;
+
+    // nullptr im Headless-Modus
     GLFWwindow* window;
 
     bool isRunning = false;
@@ -94,12 +132,22 @@ public:
     // only dark matter with diffrent colors
     int DARK_MATTER_WITH_DIFFRENT_COLORS = 10;
 
-    int colorMode = 2;
+    // Octree-Knoten, die kleiner als so viele Pixel erscheinen, werden als Aggregat gezeichnet (0 = aus)
+    float lodPixelSize = 1.0f;
+
+    // Colormap der Dichte-Modi (ColorMap::JET, GALACTIC, VIRIDIS, INFERNO), live mit C umschalten
+    int colorMode = ColorMap::GALACTIC;
+
+    // Spalten des ParticleStore, die im aktuellen Render-Modus gebraucht werden
+    uint32_t requiredFields() const;
 
     double passedTime = 0;
 
     double globalScale = 1e-9;
     void calculateGlobalScale();
+    // Maßstab und mittlere Dichte aus dem geladenen Zeitschritt, macht update(0) von selbst.
+    // Ein Video, das nicht bei 0 anfängt, ruft es mit dem ersten Zeitschritt auf
+    void calibrate();
 
     bool focusedCamera = false; 
     vec3 cameraPosition;
@@ -114,6 +162,11 @@ public:
     
     double dFromCenter = 0;
 
+    // Kamerafahrt im Video: Position und Blickrichtung hängen nur vom Zeitschritt ab,
+    // ausgehend von der Kamera beim ersten Aufruf. So können Frames einzeln, in Teilen
+    // auf mehrere Prozesse verteilt oder nach einem Abbruch weiter gerendert werden
+    void setVideoCamera(int index);
+
     
     //static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
     void onFramebufferSizeChanged(int width, int height); // Instanzfunktion
@@ -134,6 +187,23 @@ private:
     int amountOfStars = 5000;
     std::vector<bgStar> bgStars;
 
+    // Hintergrundsterne als statischer Buffer mit eigenem Shader, ein Draw-Call pro Frame
+    GLuint starProgram = 0;
+    GLuint starVAO = 0;
+    GLuint starVBO = 0;
+    GLsizei starCount = 0;
+    void uploadStars();
+
+    // Headless: eigener Kontext und FBO statt Fenster und Standard-Framebuffer
+    HeadlessContext headlessContext;
+    GLuint offscreenFramebuffer = 0;
+    GLuint offscreenColor = 0;
+    GLuint offscreenDepth = 0;
+    bool createOffscreenTarget(int targetWidth, int targetHeight);
+
+    SoftwareRenderer softwareRenderer;
+    std::vector<SoftwareRenderer::Point> softwareStars;
+
     bool tracks = false;
     double cameraViewDistance = 1e15;
     mat4 view;
@@ -145,8 +215,60 @@ private:
     GLuint shaderProgram;
     bool shouldClose = false;
     GLuint VAO;
-    GLuint instanceVBO;
     void renderParticles();
+    void renderSoftware();
+
+    // Partikel liegen als Vertex-Attribute im Stream-Buffer und werden mit einem Draw-Call gezeichnet
+    StreamBuffer particleBuffer;
+    size_t uploadedCount = 0;
+    const ParticleStore* uploadedStore = nullptr;
+    int uploadedIndex = -1;
+    bool uploadedHasType = false;
+    GLuint lodVAO = 0;
+    ParticleOctree::Selection selection;
+
+    // Partikel jedes Typs in einem eigenen Float-Layer (Textur-Array). Ein Wechsel des
+    // Render-Modus setzt nur die Layer neu zusammen, gerendert wird erst wieder, wenn sich
+    // Kamera, Zeitschritt oder Darstellung ändern
+    struct LayerState
+    {
+        const ParticleStore* store = nullptr;
+        int index = -1;
+        double camera[9] = {};
+        float scale = 0.0f;
+        float alpha = 0.0f;
+        float densityAv = 0.0f;
+        float lodPixelSize = 0.0f;
+        int colorMode = -1;
+        int width = 0;
+        int height = 0;
+        bool operator==(const LayerState& other) const;
+    };
+    LayerState layerState;
+    bool layerValid[ParticleStore::NUM_TYPES] = {};
+    GLuint layerTexture = 0;
+    GLuint layerFramebuffer = 0;
+    int layerWidth = 0;
+    int layerHeight = 0;
+    GLuint compositeProgram = 0;
+    GLuint compositeVAO = 0;
+    bool createLayerTargets(int targetWidth, int targetHeight);
+    void renderLayer(int type, const float viewProjection[16], const mat4& projection);
+    ColorMap colorMaps;
+    int currentIndex = -1;
+
+    // Startzustand der Kamerafahrt und der zuletzt berechnete Schritt
+    bool orbitStarted = false;
+    vec3 orbitStartPosition;
+    vec3 orbitStartFront;
+    vec3 orbitPosition;
+    vec3 orbitFront;
+    int orbitSteps = 0;
+
+    void uploadParticles();
+    void setParticleAttributes(size_t offset, size_t count, bool hasDensity, bool hasType, bool hasWeight);
+    uint32_t visibleTypeMask() const;
+    GLuint createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
     void checkShaderCompileStatus(GLuint shader, const char* shaderType);
     void checkShaderLinkStatus(GLuint program);
     void calcTime(int index);
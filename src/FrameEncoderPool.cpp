@@ -0,0 +1,337 @@
+#include "FrameEncoderPool.h"
+#include "ImageWriter.h"
+#include "YuvConversion.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#ifdef WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+FrameEncoderPool::FrameEncoderPool(unsigned int numWorkers, size_t maxFrames)
+{
+    if (numWorkers == 0)
+    {
+        numWorkers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Jeder Worker hat einen Frame in Arbeit, dazu zwei in der Queue, damit das Rendern weiterläuft
+    this->maxFrames = maxFrames > 0 ? maxFrames : (size_t)numWorkers + 2;
+
+    // Die Frames kommen von unten nach oben, das Umdrehen erledigt stb beim Schreiben.
+    // Das Flag ist global, also einmal setzen, bevor die Worker starten
+    stbi_flip_vertically_on_write(1);
+
+    for (unsigned int i = 0; i < numWorkers; i++)
+    {
+        workers.emplace_back(&FrameEncoderPool::worker, this);
+    }
+}
+
+FrameEncoderPool::~FrameEncoderPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        terminate = true;
+        workAvailable.notify_all();
+    }
+    for (std::thread& thread : workers)
+    {
+        thread.join();
+    }
+    if (stream == stdout)
+    {
+        fflush(stream);
+    }
+    else if (stream)
+    {
+        fclose(stream);
+    }
+}
+
+const char* FrameEncoderPool::fileExtension(int format)
+{
+    switch (format)
+    {
+    case PNG_FORMAT: return ".png";
+    case QOI_FORMAT: return ".qoi";
+    case Y4M_FORMAT: return ".y4m";
+    case RGB_FORMAT: return ".rgb";
+    default: return ".bmp";
+    }
+}
+
+bool FrameEncoderPool::readImageSize(const std::string& filename, int& width, int& height)
+{
+    unsigned char header[26] = {};
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    const size_t size = fread(header, 1, sizeof(header), file);
+    fclose(file);
+
+    auto bigEndian = [&header](int offset) {
+        return (int32_t)((uint32_t)header[offset] << 24 | (uint32_t)header[offset + 1] << 16 | (uint32_t)header[offset + 2] << 8 | header[offset + 3]);
+    };
+    auto littleEndian = [&header](int offset) {
+        return (int32_t)((uint32_t)header[offset + 3] << 24 | (uint32_t)header[offset + 2] << 16 | (uint32_t)header[offset + 1] << 8 | header[offset]);
+    };
+    if (size >= 24 && memcmp(header, "\x89PNG\r\n\x1a\n", 8) == 0 && memcmp(header + 12, "IHDR", 4) == 0)
+    {
+        width = bigEndian(16);
+        height = bigEndian(20);
+    }
+    else if (size >= 14 && memcmp(header, "qoif", 4) == 0)
+    {
+        width = bigEndian(4);
+        height = bigEndian(8);
+    }
+    else if (size >= 26 && header[0] == 'B' && header[1] == 'M')
+    {
+        // Negative Höhe heißt von oben nach unten gespeichert
+        width = littleEndian(18);
+        height = std::abs(littleEndian(22));
+    }
+    else
+    {
+        return false;
+    }
+    return width > 0 && height > 0;
+}
+
+bool FrameEncoderPool::setImageFormat(int format)
+{
+    if (format != BMP_FORMAT && format != PNG_FORMAT && format != QOI_FORMAT)
+    {
+        std::cerr << "Unknown image format " << format << std::endl;
+        return false;
+    }
+    imageFormat = format;
+    return true;
+}
+
+bool FrameEncoderPool::openStream(const std::string& path, int format, int frameRate)
+{
+    if (format != Y4M_FORMAT && format != RGB_FORMAT)
+    {
+        std::cerr << "Unknown stream format " << format << std::endl;
+        return false;
+    }
+    if (path == "-")
+    {
+#ifdef WIN32
+        // Sonst macht Windows aus jedem \n ein \r\n
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        stream = stdout;
+    }
+    else
+    {
+        stream = fopen(path.c_str(), "wb");
+        if (!stream)
+        {
+            std::cerr << "Could not open video stream " << path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    streamFormat = format;
+    this->frameRate = frameRate > 0 ? frameRate : 30;
+    return true;
+}
+
+std::unique_ptr<FrameEncoderPool::Frame> FrameEncoderPool::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    frameAvailable.wait(lock, [this] { return !freeFrames.empty() || allocated < maxFrames; });
+
+    if (!freeFrames.empty())
+    {
+        std::unique_ptr<Frame> frame = std::move(freeFrames.back());
+        freeFrames.pop_back();
+        return frame;
+    }
+    allocated++;
+    return std::unique_ptr<Frame>(new Frame());
+}
+
+void FrameEncoderPool::submit(std::unique_ptr<Frame> frame)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    frame->sequence = nextSequence++;
+    pending.push(std::move(frame));
+    workAvailable.notify_one();
+}
+
+void FrameEncoderPool::release(std::unique_ptr<Frame> frame)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    freeFrames.push_back(std::move(frame));
+    frameAvailable.notify_all();
+}
+
+void FrameEncoderPool::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    frameAvailable.wait(lock, [this] { return pending.empty() && writing == 0; });
+    if (stream)
+    {
+        fflush(stream);
+    }
+}
+
+void FrameEncoderPool::worker()
+{
+    while (true)
+    {
+        std::unique_ptr<Frame> frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this] { return !pending.empty() || terminate; });
+
+            if (terminate && pending.empty())
+            {
+                break;
+            }
+
+            frame = std::move(pending.front());
+            pending.pop();
+            writing++;
+        }
+
+        encode(*frame);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stream)
+        {
+            // Konvertiert wird parallel, geschrieben in der Reihenfolge von submit. Der
+            // älteste offene Frame ist immer schon bei einem Worker, es wartet also keiner ewig
+            writeTurn.wait(lock, [this, &frame] { return frame->sequence == nextWrite; });
+            lock.unlock();
+            writeStream(*frame);
+            lock.lock();
+            nextWrite++;
+            writeTurn.notify_all();
+        }
+
+        // Pixel-Buffer behält seine Kapazität für den nächsten Frame
+        writing--;
+        freeFrames.push_back(std::move(frame));
+        frameAvailable.notify_all();
+    }
+}
+
+void FrameEncoderPool::encode(Frame& frame)
+{
+    if (stream == nullptr)
+    {
+        // Erst unter anderem Namen schreiben und dann umbenennen: Bricht das Programm ab,
+        // liegt unter dem richtigen Namen nie ein halbes Bild, das beim Fortsetzen übersprungen würde
+        const std::string partFilename = frame.filename + ".part";
+        bool written = true;
+        if (imageFormat == PNG_FORMAT)
+        {
+            frame.encoded.clear();
+            encodePng(frame.pixels.data(), frame.width, frame.height, frame.encoded, threadPool);
+            written = writeFile(partFilename, frame.encoded);
+        }
+        else if (imageFormat == QOI_FORMAT)
+        {
+            frame.encoded.clear();
+            encodeQoi(frame.pixels.data(), frame.width, frame.height, frame.encoded);
+            written = writeFile(partFilename, frame.encoded);
+        }
+        else
+        {
+            written = stbi_write_bmp(partFilename.c_str(), frame.width, frame.height, 3, frame.pixels.data()) != 0;
+        }
+        if (written)
+        {
+            std::error_code error;
+            std::filesystem::rename(partFilename, frame.filename, error);
+            written = !error;
+        }
+        if (!written)
+        {
+            std::remove(partFilename.c_str());
+            std::cerr << "Could not write " << frame.filename << std::endl;
+        }
+        return;
+    }
+
+    if (streamFormat == Y4M_FORMAT)
+    {
+        // Frame-Header und die drei Ebenen am Stück, damit ein einziges fwrite reicht
+        static const char frameHeader[] = "FRAME\n";
+        const size_t headerSize = sizeof(frameHeader) - 1;
+        const size_t lumaSize = (size_t)frame.width * frame.height;
+        const size_t chromaSize = (size_t)chromaWidth(frame.width) * chromaHeight(frame.height);
+        frame.encoded.resize(headerSize + lumaSize + 2 * chromaSize);
+        unsigned char* out = frame.encoded.data();
+        memcpy(out, frameHeader, headerSize);
+        rgbToYuv420(frame.pixels.data(), frame.width, frame.height, true,
+            out + headerSize, out + headerSize + lumaSize, out + headerSize + lumaSize + chromaSize);
+    }
+}
+
+void FrameEncoderPool::writeStream(const Frame& frame)
+{
+    // Nur der Worker, der an der Reihe ist, kommt hierher
+    if (streamFailed)
+    {
+        return;
+    }
+    if (streamWidth == 0)
+    {
+        streamWidth = frame.width;
+        streamHeight = frame.height;
+        if (streamFormat == Y4M_FORMAT)
+        {
+            // C420jpeg: Chroma in der Mitte der 2x2 Blöcke, wie beim Mittelwert in rgbToYuv420
+            fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", streamWidth, streamHeight, frameRate);
+        }
+    }
+    if (frame.width != streamWidth || frame.height != streamHeight)
+    {
+        std::cerr << "Frame size " << frame.width << "x" << frame.height << " does not match the video stream ("
+            << streamWidth << "x" << streamHeight << "), frame skipped" << std::endl;
+        return;
+    }
+
+    bool written = true;
+    if (streamFormat == Y4M_FORMAT)
+    {
+        written = fwrite(frame.encoded.data(), 1, frame.encoded.size(), stream) == frame.encoded.size();
+    }
+    else
+    {
+        // Rohes RGB von oben nach unten
+        const size_t stride = (size_t)3 * frame.width;
+        for (int row = frame.height - 1; row >= 0 && written; row--)
+        {
+            written = fwrite(frame.pixels.data() + stride * row, 1, stride, stream) == stride;
+        }
+    }
+    if (!written)
+    {
+        std::cerr << "Could not write to the video stream: " << strerror(errno) << std::endl;
+        streamFailed = true;
+    }
+}
+
+bool FrameEncoderPool::writeFile(const std::string& filename, const std::vector<unsigned char>& data)
+{
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && written;
+}
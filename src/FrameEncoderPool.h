@@ -0,0 +1,109 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ThreadPool;
+
+// Fixed set of threads that write finished video frames to disk. At most maxFrames
+// frame buffers exist at any time: when all of them are queued or being written,
+// acquire() blocks the render loop until a worker is done with one, so memory stays
+// bounded however slow the encoder is. Written frames go back to a free list and are
+// handed out again, a buffer of the same size is never reallocated.
+// Frames either become one image file each (BMP, PNG or QOI) or are appended to a single
+// stream (raw RGB or YUV4MPEG2), which the workers convert in parallel and write in
+// submission order.
+class FrameEncoderPool
+{
+public:
+    static const int BMP_FORMAT = 0;  // Picture_<n>.bmp pro Frame
+    static const int Y4M_FORMAT = 1;  // YUV4MPEG2, 4:2:0
+    static const int RGB_FORMAT = 2;  // rohe RGB24-Frames ohne Header
+    static const int PNG_FORMAT = 3;  // Picture_<n>.png, verlustfrei
+    static const int QOI_FORMAT = 4;  // Picture_<n>.qoi, verlustfrei und schneller als PNG
+
+    static bool isStreamFormat(int format) { return format == Y4M_FORMAT || format == RGB_FORMAT; }
+    // Dateiendung der Bildformate, z.B. ".png"
+    static const char* fileExtension(int format);
+    // Bildgröße aus dem Header einer BMP-, PNG- oder QOI-Datei, false bei anderen oder kaputten Dateien
+    static bool readImageSize(const std::string& filename, int& width, int& height);
+
+    // RGB, bottom row first like glReadPixels
+    struct Frame
+    {
+        std::string filename;  // nur bei Bildformaten
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+        std::vector<unsigned char> encoded; // kodierter Frame, Kapazität bleibt erhalten
+        uint64_t sequence = 0;
+    };
+
+    // numWorkers = 0 uses all hardware threads, maxFrames = 0 allows two frames more than workers
+    FrameEncoderPool(unsigned int numWorkers = 0, size_t maxFrames = 0);
+    // Writes all submitted frames before the workers stop and closes the stream
+    ~FrameEncoderPool();
+
+    FrameEncoderPool(const FrameEncoderPool&) = delete;
+    FrameEncoderPool& operator=(const FrameEncoderPool&) = delete;
+
+    unsigned int numWorkers() const { return (unsigned int)workers.size(); }
+    size_t capacity() const { return maxFrames; }
+
+    // Threads für die Bänder eines PNG, ohne Pool komprimiert der Worker allein
+    ThreadPool* threadPool = nullptr;
+
+    // Format der Bilddateien (BMP_FORMAT, PNG_FORMAT oder QOI_FORMAT), vor dem ersten Frame setzen
+    bool setImageFormat(int format);
+
+    // Streams all following frames into path ("-" = stdout) instead of one file per
+    // frame. A named pipe works as well, so an encoder like ffmpeg can read the video
+    // while it is rendered. The frame size is taken from the first frame.
+    bool openStream(const std::string& path, int format, int frameRate);
+    bool streaming() const { return stream != nullptr; }
+
+    // Free frame, blocks while all maxFrames frames are in use
+    std::unique_ptr<Frame> acquire();
+    // Queues a filled frame for writing
+    void submit(std::unique_ptr<Frame> frame);
+    // Returns an acquired frame that is not going to be written
+    void release(std::unique_ptr<Frame> frame);
+    // Blocks until every submitted frame is written
+    void flush();
+
+private:
+    void worker();
+    void encode(Frame& frame);
+    void writeStream(const Frame& frame);
+    static bool writeFile(const std::string& filename, const std::vector<unsigned char>& data);
+
+    std::vector<std::thread> workers;
+    std::queue<std::unique_ptr<Frame>> pending;
+    std::vector<std::unique_ptr<Frame>> freeFrames;
+    size_t maxFrames = 0;
+    size_t allocated = 0; // erzeugte Frames, nie mehr als maxFrames
+    size_t writing = 0;   // gerade von einem Worker geschrieben
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable frameAvailable;
+    bool terminate = false;
+    int imageFormat = BMP_FORMAT;
+
+    // Stream: Frames werden parallel konvertiert, aber der Reihe nach geschrieben
+    FILE* stream = nullptr;
+    int streamFormat = BMP_FORMAT;
+    int frameRate = 30;
+    int streamWidth = 0;
+    int streamHeight = 0;
+    bool streamFailed = false;
+    uint64_t nextSequence = 0;  // nächster Frame von submit
+    uint64_t nextWrite = 0;     // nächster Frame, der in den Stream darf
+    std::condition_variable writeTurn;
+};
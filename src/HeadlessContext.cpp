@@ -0,0 +1,150 @@
+#include "HeadlessContext.h"
+#include <iostream>
+#include <cstring>
+
+#ifdef AGRENDER_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static bool hasExtension(const char* extensions, const char* name)
+{
+    if (extensions == nullptr)
+    {
+        return false;
+    }
+    size_t length = strlen(name);
+    for (const char* p = strstr(extensions, name); p != nullptr; p = strstr(p + length, name))
+    {
+        // Nur ganze Namen, nicht Präfixe anderer Erweiterungen
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static EGLDisplay openDisplay()
+{
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+    }
+
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_EXT_platform_device"))
+    {
+        PFNEGLQUERYDEVICESEXTPROC queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+        EGLDeviceEXT device;
+        EGLint numDevices = 0;
+        if (queryDevices && queryDevices(1, &device, &numDevices) && numDevices > 0)
+        {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+        }
+    }
+
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+    return EGL_NO_DISPLAY;
+}
+#endif
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+bool HeadlessContext::create(int major, int minor)
+{
+#ifdef AGRENDER_HEADLESS
+    destroy();
+
+    EGLDisplay eglDisplay = openDisplay();
+    if (eglDisplay == EGL_NO_DISPLAY)
+    {
+        std::cerr << "Failed to open an EGL display" << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cerr << "EGL does not support desktop OpenGL" << std::endl;
+        destroy();
+        return false;
+    }
+
+    // Farb- und Tiefenpuffer liegen im FBO der Engine, die Konfiguration braucht nur OpenGL
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+    {
+        std::cerr << "No EGL config with OpenGL support" << std::endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        std::cerr << "Failed to create an OpenGL " << major << "." << minor << " context through EGL" << std::endl;
+        destroy();
+        return false;
+    }
+    context = eglContext;
+
+    // Ohne surfaceless_context braucht eglMakeCurrent eine (kleine) Pbuffer-Oberfläche
+    EGLSurface eglSurface = EGL_NO_SURFACE;
+    if (!hasExtension(eglQueryString(eglDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+        eglSurface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttributes);
+        surface = eglSurface;
+    }
+
+    if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext))
+    {
+        std::cerr << "Failed to make the EGL context current" << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+#else
+    (void)major;
+    (void)minor;
+    std::cerr << "Headless rendering is not available, build with AGRENDER_HEADLESS (EGL)" << std::endl;
+    return false;
+#endif
+}
+
+void HeadlessContext::destroy()
+{
+#ifdef AGRENDER_HEADLESS
+    if (display == nullptr)
+    {
+        return;
+    }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface) eglDestroySurface(display, surface);
+    if (context) eglDestroyContext(display, context);
+    eglTerminate(display);
+#endif
+    surface = nullptr;
+    context = nullptr;
+    display = nullptr;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// OpenGL context without a window, for video rendering on machines without a display.
+// Uses EGL: Mesa's surfaceless platform (also llvmpipe on CPU-only machines), then an
+// EGL device (NVIDIA without X), then the default display. There is no default
+// framebuffer, the engine renders into its own FBO.
+// Only available when built with AGRENDER_HEADLESS, otherwise create() fails.
+class HeadlessContext
+{
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Creates a core profile context of the given version and makes it current
+    bool create(int major, int minor);
+    void destroy();
+
+    bool isCreated() const { return context != nullptr; }
+
+private:
+    // EGLDisplay, EGLContext, EGLSurface, so EGL stays out of this header
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+};
@@ -0,0 +1,457 @@
+#include "ImageWriter.h"
+#include "ThreadPool.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    // Zeile row von oben gezählt, die Eingabe liegt von unten nach oben im Speicher
+    inline const uint8_t* imageRow(const uint8_t* rgb, int width, int height, int row)
+    {
+        return rgb + (size_t)3 * width * (height - 1 - row);
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        static const struct Table
+        {
+            uint32_t entries[256];
+            Table()
+            {
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    entries[n] = c;
+                }
+            }
+        } table;
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    const uint32_t ADLER_BASE = 65521;
+
+    uint32_t adler32(const uint8_t* data, size_t size)
+    {
+        uint32_t a = 1, b = 0;
+        while (size > 0)
+        {
+            // Ohne Überlauf höchstens 5552 Bytes zwischen zwei Modulo-Operationen
+            size_t block = size < 5552 ? size : 5552;
+            for (size_t i = 0; i < block; i++)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= ADLER_BASE;
+            b %= ADLER_BASE;
+            data += block;
+            size -= block;
+        }
+        return (b << 16) | a;
+    }
+
+    // Adler-32 von A+B aus den Prüfsummen von A und B (B ist lengthB Bytes lang), wie adler32_combine in zlib
+    uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, size_t lengthB)
+    {
+        uint32_t remainder = (uint32_t)(lengthB % ADLER_BASE);
+        uint32_t sum1 = adlerA & 0xFFFF;
+        uint32_t sum2 = (uint32_t)(((uint64_t)remainder * sum1) % ADLER_BASE);
+        sum1 += (adlerB & 0xFFFF) + ADLER_BASE - 1;
+        sum2 += (adlerA >> 16) + (adlerB >> 16) + ADLER_BASE - remainder;
+        if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+        if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+        if (sum2 >= 2 * ADLER_BASE) sum2 -= 2 * ADLER_BASE;
+        if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+        return (sum2 << 16) | sum1;
+    }
+
+    // Deflate schreibt die Bits vom niederwertigsten an, Huffman-Codes aber vom höchsten Bit an
+    struct BitWriter
+    {
+        std::vector<uint8_t>& out;
+        uint64_t bits = 0;
+        int count = 0;
+
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        void put(uint32_t value, int length)
+        {
+            bits |= (uint64_t)value << count;
+            count += length;
+            while (count >= 8)
+            {
+                out.push_back((uint8_t)bits);
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+
+        void putCode(uint32_t code, int length)
+        {
+            uint32_t reversed = 0;
+            for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+            put(reversed, length);
+        }
+
+        void align()
+        {
+            if (count > 0) put(0, 8 - count);
+        }
+    };
+
+    // Feste Huffman-Codes aus RFC 1951, 3.2.6
+    void putSymbol(BitWriter& writer, int symbol)
+    {
+        if (symbol < 144) writer.putCode(0x30 + symbol, 8);
+        else if (symbol < 256) writer.putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280) writer.putCode(symbol - 256, 7);
+        else writer.putCode(0xC0 + symbol - 280, 8);
+    }
+
+    const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    void putMatch(BitWriter& writer, int length, int distance)
+    {
+        int code = 28;
+        while (LENGTH_BASE[code] > length) code--;
+        putSymbol(writer, 257 + code);
+        writer.put(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+        code = 29;
+        while (DISTANCE_BASE[code] > distance) code--;
+        writer.putCode(code, 5);
+        writer.put(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+    }
+
+    const int WINDOW_SIZE = 32768;
+    const int HASH_BITS = 15;
+    const int MAX_MATCH = 258;
+    const int MAX_CHAIN = 32;
+    const int MAX_INSERT_LENGTH = 16;
+
+    // Ein Block mit festen Huffman-Codes, LZ77 über Hash-Ketten. Ohne last endet der Band
+    // mit einem leeren Stored-Block (Sync-Flush) auf einer Bytegrenze, so dass das nächste
+    // Band direkt angehängt werden kann
+    void deflateBand(const uint8_t* data, size_t size, bool last, std::vector<uint8_t>& out)
+    {
+        std::vector<int32_t> head((size_t)1 << HASH_BITS, -1);
+        std::vector<int32_t> previous(WINDOW_SIZE, -1);
+        auto hash = [data](size_t i) {
+            uint32_t value = (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) | ((uint32_t)data[i + 2] << 16);
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        };
+        auto insert = [&](size_t i) {
+            uint32_t h = hash(i);
+            previous[i & (WINDOW_SIZE - 1)] = head[h];
+            head[h] = (int32_t)i;
+        };
+
+        BitWriter writer(out);
+        writer.put(last ? 1 : 0, 1);
+        writer.put(1, 2);
+
+        size_t i = 0;
+        while (i < size)
+        {
+            int bestLength = 0;
+            int bestDistance = 0;
+            if (i + 3 <= size)
+            {
+                const int maxLength = (int)(size - i < (size_t)MAX_MATCH ? size - i : MAX_MATCH);
+                int32_t candidate = head[hash(i)];
+                for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; chain++)
+                {
+                    if (i - candidate > (size_t)WINDOW_SIZE) break;
+                    int length = 0;
+                    while (length < maxLength && data[candidate + length] == data[i + length]) length++;
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = (int)(i - candidate);
+                        if (length == maxLength) break;
+                    }
+                    // Der Ring überschreibt alte Einträge, Ketten müssen streng rückwärts laufen
+                    int32_t next = previous[candidate & (WINDOW_SIZE - 1)];
+                    if (next >= candidate) break;
+                    candidate = next;
+                }
+            }
+
+            if (bestLength >= 3)
+            {
+                putMatch(writer, bestLength, bestDistance);
+                // Lange Treffer (meist schwarze Flächen) nur am Ende eintragen, wie die schnellen
+                // Stufen von zlib, sonst kostet jedes Byte eines leeren Bildes einen Hash
+                size_t end = i + bestLength;
+                i = bestLength <= MAX_INSERT_LENGTH ? i + 1 : end - 3;
+                for (; i < end; i++)
+                {
+                    if (i + 3 <= size) insert(i);
+                }
+            }
+            else
+            {
+                putSymbol(writer, data[i]);
+                if (i + 3 <= size) insert(i);
+                i++;
+            }
+        }
+        putSymbol(writer, 256);
+
+        if (!last)
+        {
+            writer.put(0, 1);
+            writer.put(0, 2);
+            writer.align();
+            const uint8_t emptyStored[4] = { 0x00, 0x00, 0xFF, 0xFF };
+            out.insert(out.end(), emptyStored, emptyStored + 4);
+        }
+        else
+        {
+            writer.align();
+        }
+    }
+
+    inline uint8_t paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return (uint8_t)a;
+        return (uint8_t)(pb <= pc ? b : c);
+    }
+
+    // Filtert eine Zeile mit allen fünf PNG-Filtern und nimmt den mit der kleinsten Summe
+    // der Beträge (als vorzeichenbehaftete Bytes), dieselbe Heuristik wie stb_image_write.
+    // scratch hat Platz für fünf gefilterte Zeilen
+    void filterRow(const uint8_t* row, const uint8_t* above, int rowBytes, uint8_t* out, std::vector<uint8_t>& scratch)
+    {
+        scratch.resize((size_t)5 * rowBytes);
+        uint8_t* none = scratch.data();
+        uint8_t* sub = none + rowBytes;
+        uint8_t* up = sub + rowBytes;
+        uint8_t* average = up + rowBytes;
+        uint8_t* paethRow = average + rowBytes;
+
+        // Die ersten drei Bytes haben keinen linken Nachbarn
+        for (int i = 0; i < rowBytes && i < 3; i++)
+        {
+            int top = above ? above[i] : 0;
+            none[i] = row[i];
+            sub[i] = row[i];
+            up[i] = (uint8_t)(row[i] - top);
+            average[i] = (uint8_t)(row[i] - (top >> 1));
+            paethRow[i] = (uint8_t)(row[i] - top);
+        }
+        if (above)
+        {
+            for (int i = 3; i < rowBytes; i++)
+            {
+                none[i] = row[i];
+                sub[i] = (uint8_t)(row[i] - row[i - 3]);
+                up[i] = (uint8_t)(row[i] - above[i]);
+                average[i] = (uint8_t)(row[i] - ((row[i - 3] + above[i]) >> 1));
+                paethRow[i] = (uint8_t)(row[i] - paeth(row[i - 3], above[i], above[i - 3]));
+            }
+        }
+        else
+        {
+            // Über der ersten Zeile ist alles 0: Paeth wird zu Sub
+            for (int i = 3; i < rowBytes; i++)
+            {
+                none[i] = row[i];
+                sub[i] = (uint8_t)(row[i] - row[i - 3]);
+                up[i] = row[i];
+                average[i] = (uint8_t)(row[i] - (row[i - 3] >> 1));
+                paethRow[i] = sub[i];
+            }
+        }
+
+        int bestFilter = 0;
+        long bestSum = -1;
+        for (int filter = 0; filter < 5; filter++)
+        {
+            const uint8_t* filtered = scratch.data() + (size_t)filter * rowBytes;
+            long sum = 0;
+            for (int i = 0; i < rowBytes; i++) sum += std::abs((int)(int8_t)filtered[i]);
+            if (bestSum < 0 || sum < bestSum)
+            {
+                bestSum = sum;
+                bestFilter = filter;
+            }
+        }
+        out[0] = (uint8_t)bestFilter;
+        memcpy(out + 1, scratch.data() + (size_t)bestFilter * rowBytes, rowBytes);
+    }
+
+    void putChunk(std::vector<uint8_t>& out, const char type[4], const uint8_t* data, size_t size)
+    {
+        putBigEndian(out, (uint32_t)size);
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+        putBigEndian(out, crc32(out.data() + start, out.size() - start));
+    }
+}
+
+void encodeQoi(const uint8_t* rgb, int width, int height, std::vector<uint8_t>& out)
+{
+    out.reserve(out.size() + 14 + (size_t)4 * width * height + 8);
+    const char magic[4] = { 'q', 'o', 'i', 'f' };
+    out.insert(out.end(), magic, magic + 4);
+    putBigEndian(out, (uint32_t)width);
+    putBigEndian(out, (uint32_t)height);
+    out.push_back(3); // RGB
+    out.push_back(0); // sRGB
+
+    // Alpha ist immer 255 und geht als Konstante in den Hash ein. Die Einträge starten wie
+    // beim Decoder mit Alpha 0, damit ein unbenutzter Eintrag nie zu Schwarz passt
+    uint8_t index[64][4] = {};
+    uint8_t previous[3] = { 0, 0, 0 };
+    int run = 0;
+    for (int row = 0; row < height; row++)
+    {
+        const uint8_t* pixel = imageRow(rgb, width, height, row);
+        for (int x = 0; x < width; x++, pixel += 3)
+        {
+            if (pixel[0] == previous[0] && pixel[1] == previous[1] && pixel[2] == previous[2])
+            {
+                if (++run == 62)
+                {
+                    out.push_back((uint8_t)(0xC0 | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0)
+            {
+                out.push_back((uint8_t)(0xC0 | (run - 1)));
+                run = 0;
+            }
+
+            int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64;
+            if (index[hash][0] == pixel[0] && index[hash][1] == pixel[1] && index[hash][2] == pixel[2] && index[hash][3] == 255)
+            {
+                out.push_back((uint8_t)hash);
+            }
+            else
+            {
+                memcpy(index[hash], pixel, 3);
+                index[hash][3] = 255;
+                int dr = (int8_t)(pixel[0] - previous[0]);
+                int dg = (int8_t)(pixel[1] - previous[1]);
+                int db = (int8_t)(pixel[2] - previous[2]);
+                int drdg = dr - dg;
+                int dbdg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                {
+                    out.push_back((uint8_t)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                }
+                else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7)
+                {
+                    out.push_back((uint8_t)(0x80 | (dg + 32)));
+                    out.push_back((uint8_t)((drdg + 8) << 4 | (dbdg + 8)));
+                }
+                else
+                {
+                    out.push_back(0xFE);
+                    out.insert(out.end(), pixel, pixel + 3);
+                }
+            }
+            memcpy(previous, pixel, 3);
+        }
+    }
+    if (run > 0)
+    {
+        out.push_back((uint8_t)(0xC0 | (run - 1)));
+    }
+    const uint8_t end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    out.insert(out.end(), end, end + 8);
+}
+
+void encodePng(const uint8_t* rgb, int width, int height, std::vector<uint8_t>& out, ThreadPool* threadPool)
+{
+    const int rowBytes = 3 * width;
+    const size_t numBands = ((size_t)height + PNG_BAND_ROWS - 1) / PNG_BAND_ROWS;
+
+    // Jedes Band wird für sich gefiltert (die Zeile darüber liegt ja ungefiltert vor) und komprimiert
+    std::vector<std::vector<uint8_t>> bands(numBands);
+    std::vector<uint32_t> bandAdler(numBands);
+    std::vector<size_t> bandSize(numBands);
+    auto encodeBand = [&](size_t band) {
+        const int firstRow = (int)band * PNG_BAND_ROWS;
+        const int lastRow = firstRow + PNG_BAND_ROWS < height ? firstRow + PNG_BAND_ROWS : height;
+        std::vector<uint8_t> filtered((size_t)(lastRow - firstRow) * (rowBytes + 1));
+        std::vector<uint8_t> scratch;
+        for (int row = firstRow; row < lastRow; row++)
+        {
+            const uint8_t* above = row > 0 ? imageRow(rgb, width, height, row - 1) : nullptr;
+            filterRow(imageRow(rgb, width, height, row), above, rowBytes, filtered.data() + (size_t)(row - firstRow) * (rowBytes + 1), scratch);
+        }
+        bandAdler[band] = adler32(filtered.data(), filtered.size());
+        bandSize[band] = filtered.size();
+        bands[band].reserve(filtered.size() / 4);
+        deflateBand(filtered.data(), filtered.size(), band + 1 == numBands, bands[band]);
+    };
+    if (threadPool)
+    {
+        threadPool->parallelTasks(numBands, encodeBand);
+    }
+    else
+    {
+        for (size_t band = 0; band < numBands; band++) encodeBand(band);
+    }
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.insert(out.end(), signature, signature + 8);
+
+    uint8_t header[13];
+    header[0] = (uint8_t)(width >> 24); header[1] = (uint8_t)(width >> 16); header[2] = (uint8_t)(width >> 8); header[3] = (uint8_t)width;
+    header[4] = (uint8_t)(height >> 24); header[5] = (uint8_t)(height >> 16); header[6] = (uint8_t)(height >> 8); header[7] = (uint8_t)height;
+    header[8] = 8;  // Bit pro Kanal
+    header[9] = 2;  // RGB
+    header[10] = 0; // Deflate
+    header[11] = 0; // adaptive Filter
+    header[12] = 0; // kein Interlacing
+    putChunk(out, "IHDR", header, sizeof(header));
+
+    // IDAT: zlib-Header, die Bänder hintereinander und die Adler-32 über alle gefilterten Daten
+    size_t compressedSize = 2 + 4;
+    uint32_t adler = 1;
+    for (size_t band = 0; band < numBands; band++)
+    {
+        compressedSize += bands[band].size();
+        adler = adler32Combine(adler, bandAdler[band], bandSize[band]);
+    }
+    putBigEndian(out, (uint32_t)compressedSize);
+    const size_t start = out.size();
+    const char idat[4] = { 'I', 'D', 'A', 'T' };
+    out.insert(out.end(), idat, idat + 4);
+    out.push_back(0x78);
+    out.push_back(0x01);
+    for (const std::vector<uint8_t>& band : bands)
+    {
+        out.insert(out.end(), band.begin(), band.end());
+    }
+    putBigEndian(out, adler);
+    putBigEndian(out, crc32(out.data() + start, out.size() - start));
+
+    putChunk(out, "IEND", nullptr, 0);
+}
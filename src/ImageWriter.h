@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Lossless image files for the video frames. The input is RGB, bottom row first like
+// glReadPixels, the files are written top row first. Both encoders append to out, so a
+// recycled buffer keeps its capacity between frames.
+
+// QOI ("Quite OK Image"): single pass, several times faster than PNG and usually as small
+void encodeQoi(const uint8_t* rgb, int width, int height, std::vector<uint8_t>& out);
+
+// PNG with per-row filters chosen like stb_image_write and fixed Huffman deflate. The image
+// is split into bands of PNG_BAND_ROWS rows that are filtered and compressed independently,
+// in parallel when a pool is given, and stitched into one zlib stream. Band boundaries do
+// not depend on the number of threads, so the file is always the same.
+static const int PNG_BAND_ROWS = 64;
+void encodePng(const uint8_t* rgb, int width, int height, std::vector<uint8_t>& out, ThreadPool* threadPool);
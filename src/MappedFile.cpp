@@ -0,0 +1,162 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::MappedFile(const std::string& path, bool useMapping)
+{
+    open(path, useMapping);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path, bool useMapping)
+{
+    close();
+
+    if (useMapping && openMapping(path))
+    {
+        return true;
+    }
+    return openStream(path);
+}
+
+bool MappedFile::openStream(const std::string& path)
+{
+    stream.open(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!stream.is_open())
+    {
+        return false;
+    }
+    fileSize = static_cast<size_t>(stream.tellg());
+    if (fileSize == 0)
+    {
+        stream.close();
+        return false;
+    }
+    // Nicht initialisiert, nur gelesene Bereiche werden tatsächlich belegt
+    buffer.reset(new char[fileSize]);
+    return true;
+}
+
+bool MappedFile::openMapping(const std::string& path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (map == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(map);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = map;
+    mapping = view;
+    fileSize = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // Snapshots werden einmal von vorne nach hinten gelesen
+    madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    fileDescriptor = fd;
+    mapping = view;
+    fileSize = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mapping) UnmapViewOfFile(mapping);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mapping) munmap(mapping, fileSize);
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    mapping = nullptr;
+    fileSize = 0;
+
+    if (stream.is_open()) stream.close();
+    stream.clear();
+    buffer.reset();
+}
+
+const char* MappedFile::range(size_t offset, size_t length)
+{
+    if (!isOpen() || offset > fileSize || length > fileSize - offset)
+    {
+        return nullptr;
+    }
+    if (mapping != nullptr)
+    {
+        return static_cast<const char*>(mapping) + offset;
+    }
+
+    stream.clear();
+    stream.seekg(static_cast<std::streamoff>(offset));
+    stream.read(buffer.get() + offset, static_cast<std::streamsize>(length));
+    if (!stream)
+    {
+        return nullptr;
+    }
+    return buffer.get() + offset;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+// Without mapping (disabled or not possible) only the requested ranges are read
+// with seek + read into a buffer, so skipped parts of the file are never read.
+class MappedFile
+{
+public:
+    MappedFile();
+    MappedFile(const std::string& path, bool useMapping = true);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, bool useMapping = true);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr || stream.is_open(); }
+    bool isMapped() const { return mapping != nullptr; }
+    size_t size() const { return fileSize; }
+
+    // Pointer to [offset, offset + length) or nullptr if the range is outside the file.
+    // In stream mode the range is read on this call, the pointer stays valid until close().
+    const char* range(size_t offset, size_t length);
+
+private:
+    bool openMapping(const std::string& path);
+    bool openStream(const std::string& path);
+
+    void* mapping = nullptr;
+    size_t fileSize = 0;
+
+    std::ifstream stream;
+    std::unique_ptr<char[]> buffer;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+
+// Typed view over fixed size records lying in place inside a mapped file.
+// Record has to be a packed struct (alignment 1), so no copy is needed.
+template <typename Record>
+class RecordView
+{
+public:
+    RecordView() = default;
+    RecordView(const char* data, size_t count) : records(reinterpret_cast<const Record*>(data)), count(count) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const Record& operator[](size_t i) const { return records[i]; }
+    const Record* begin() const { return records; }
+    const Record* end() const { return records + count; }
+
+private:
+    static_assert(alignof(Record) == 1, "RecordView needs a packed record layout");
+
+    const Record* records = nullptr;
+    size_t count = 0;
+};
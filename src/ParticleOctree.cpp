@@ -0,0 +1,464 @@
+#include "ParticleOctree.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace
+{
+    // Feste Blockgröße, damit die Sortierung unabhängig von der Threadanzahl ist
+    const size_t BLOCK_SIZE = (size_t)1 << 16;
+    const size_t MAX_BLOCKS = 64;
+    const int RADIX_BITS = 10;
+    // Der Typ liegt über den 30 Bit des Morton-Codes
+    const int TYPE_SHIFT = 3 * ParticleOctree::MAX_DEPTH;
+    static_assert(ParticleStore::NUM_TYPES <= 4, "type does not fit above the Morton code");
+    const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+    void forEach(ThreadPool* threadPool, size_t count, const std::function<void(size_t)>& fn)
+    {
+        if (threadPool)
+        {
+            threadPool->parallelTasks(count, fn);
+            return;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            fn(i);
+        }
+    }
+
+    // 10 Bit auf jedes dritte Bit verteilen
+    uint32_t expandBits(uint32_t v)
+    {
+        v &= 0x3FF;
+        v = (v | (v << 16)) & 0x030000FF;
+        v = (v | (v << 8)) & 0x0300F00F;
+        v = (v | (v << 4)) & 0x030C30C3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    uint32_t quantize(float v, float origin, float cellsPerUnit)
+    {
+        // NaN und Werte außerhalb landen in der ersten bzw. letzten Zelle
+        float cell = (v - origin) * cellsPerUnit;
+        if (!(cell > 0.0f)) return 0;
+        if (cell >= (float)(RADIX_SIZE - 1)) return RADIX_SIZE - 1;
+        return (uint32_t)cell;
+    }
+
+    template <typename T>
+    void gather(Column<T>& column, const std::vector<uint32_t>& order, size_t numBlocks, ThreadPool* threadPool)
+    {
+        if (column.size() != order.size()) return;
+        const size_t n = order.size();
+        Column<T> sorted;
+        sorted.resize(n);
+        forEach(threadPool, numBlocks, [&](size_t block) {
+            for (size_t i = block * n / numBlocks; i < (block + 1) * n / numBlocks; i++)
+            {
+                sorted[i] = column[order[i]];
+            }
+        });
+        column.swap(sorted);
+    }
+
+    struct Accumulator
+    {
+        double sum[4] = {}; // x, y, z, Dichte
+    };
+}
+
+void ParticleOctree::clear()
+{
+    nodes.clear();
+    roots.clear();
+    lodX.clear();
+    lodY.clear();
+    lodZ.clear();
+    lodDensity.clear();
+    lodWeight.clear();
+    lodType.clear();
+}
+
+size_t ParticleOctree::memoryUsage() const
+{
+    size_t bytes = nodes.capacity() * sizeof(Node);
+    bytes += (lodX.capacity() + lodY.capacity() + lodZ.capacity() + lodDensity.capacity() + lodWeight.capacity()) * sizeof(float);
+    bytes += lodType.capacity() + roots.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+void ParticleOctree::build(ParticleStore& particles, ThreadPool* threadPool)
+{
+    clear();
+    const size_t n = particles.size();
+    if (n > std::numeric_limits<uint32_t>::max())
+    {
+        return;
+    }
+    const bool hasType = particles.hasFields(ParticleStore::Type);
+    const bool hasDensity = particles.hasFields(ParticleStore::Density);
+    auto typeOf = [&particles, hasType](size_t i) -> uint32_t {
+        return hasType && particles.type[i] < ParticleStore::NUM_TYPES ? particles.type[i] : 0;
+    };
+    const size_t numBlocks = std::min(std::max(n / BLOCK_SIZE, (size_t)1), MAX_BLOCKS);
+    auto blockBegin = [n, numBlocks](size_t block) { return block * n / numBlocks; };
+
+    // Würfel um alle Positionen
+    std::vector<float> blockBounds(numBlocks * 6);
+    forEach(threadPool, numBlocks, [&](size_t block) {
+        float bounds[6] = { INFINITY, INFINITY, INFINITY, -INFINITY, -INFINITY, -INFINITY };
+        const float* axes[3] = { particles.x.data(), particles.y.data(), particles.z.data() };
+        for (size_t i = blockBegin(block); i < blockBegin(block + 1); i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float v = axes[axis][i];
+                if (v < bounds[axis]) bounds[axis] = v;
+                if (v > bounds[3 + axis]) bounds[3 + axis] = v;
+            }
+        }
+        std::copy(bounds, bounds + 6, blockBounds.begin() + 6 * block);
+    });
+    float origin[3] = { INFINITY, INFINITY, INFINITY };
+    float extent = 0.0f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float high = -INFINITY;
+        for (size_t block = 0; block < numBlocks; block++)
+        {
+            origin[axis] = std::min(origin[axis], blockBounds[6 * block + axis]);
+            high = std::max(high, blockBounds[6 * block + 3 + axis]);
+        }
+        if (!std::isfinite(origin[axis]) || !std::isfinite(high))
+        {
+            origin[axis] = 0.0f;
+            high = 0.0f;
+        }
+        extent = std::max(extent, high - origin[axis]);
+    }
+    const float cellsPerUnit = extent > 0.0f && std::isfinite(extent) ? RADIX_SIZE / extent : 0.0f;
+
+    // Schlüssel: Typ in den obersten zwei Bit, darunter der Morton-Code mit 10 Bit pro Achse
+    std::vector<uint32_t> codes(n);
+    forEach(threadPool, numBlocks, [&](size_t block) {
+        for (size_t i = blockBegin(block); i < blockBegin(block + 1); i++)
+        {
+            codes[i] = (typeOf(i) << TYPE_SHIFT)
+                | (expandBits(quantize(particles.x[i], origin[0], cellsPerUnit)) << 2)
+                | (expandBits(quantize(particles.y[i], origin[1], cellsPerUnit)) << 1)
+                | expandBits(quantize(particles.z[i], origin[2], cellsPerUnit));
+        }
+    });
+
+    // Stabiles LSD-Radix-Sort in vier Durchgängen, Histogramm und Verteilung pro Block parallel
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        order[i] = (uint32_t)i;
+    }
+    std::vector<uint32_t> codesOut(n);
+    std::vector<uint32_t> orderOut(n);
+    std::vector<size_t> histogram(numBlocks * RADIX_SIZE);
+    for (int pass = 0; pass * RADIX_BITS < 32; pass++)
+    {
+        const int shift = pass * RADIX_BITS;
+        std::fill(histogram.begin(), histogram.end(), 0);
+        forEach(threadPool, numBlocks, [&](size_t block) {
+            size_t* counts = &histogram[block * RADIX_SIZE];
+            for (size_t i = blockBegin(block); i < blockBegin(block + 1); i++)
+            {
+                counts[(codes[i] >> shift) & (RADIX_SIZE - 1)]++;
+            }
+        });
+
+        // Startposition jedes Blocks pro Ziffer
+        size_t offset = 0;
+        for (uint32_t digit = 0; digit < RADIX_SIZE; digit++)
+        {
+            for (size_t block = 0; block < numBlocks; block++)
+            {
+                size_t count = histogram[block * RADIX_SIZE + digit];
+                histogram[block * RADIX_SIZE + digit] = offset;
+                offset += count;
+            }
+        }
+
+        forEach(threadPool, numBlocks, [&](size_t block) {
+            size_t* next = &histogram[block * RADIX_SIZE];
+            for (size_t i = blockBegin(block); i < blockBegin(block + 1); i++)
+            {
+                size_t target = next[(codes[i] >> shift) & (RADIX_SIZE - 1)]++;
+                codesOut[target] = codes[i];
+                orderOut[target] = order[i];
+            }
+        });
+        codes.swap(codesOut);
+        order.swap(orderOut);
+    }
+    std::vector<uint32_t>().swap(codesOut);
+    std::vector<uint32_t>().swap(orderOut);
+
+    // Alle Spalten nach Typ und Morton-Code ordnen
+    gather(particles.x, order, numBlocks, threadPool);
+    gather(particles.y, order, numBlocks, threadPool);
+    gather(particles.z, order, numBlocks, threadPool);
+    gather(particles.density, order, numBlocks, threadPool);
+    gather(particles.temperature, order, numBlocks, threadPool);
+    gather(particles.mass, order, numBlocks, threadPool);
+    gather(particles.type, order, numBlocks, threadPool);
+    gather(particles.galaxyPart, order, numBlocks, threadPool);
+    gather(particles.id, order, numBlocks, threadPool);
+    std::vector<uint32_t>().swap(order);
+
+    // Bereiche der Typen und ein Baum pro Typ
+    roots.assign(ParticleStore::NUM_TYPES, NO_NODE);
+    particles.typeBegin[0] = 0;
+    for (uint32_t type = 0; type < (uint32_t)ParticleStore::NUM_TYPES; type++)
+    {
+        size_t begin = particles.typeBegin[type];
+        size_t end = std::partition_point(codes.begin() + begin, codes.end(),
+            [type](uint32_t code) { return (code >> TYPE_SHIFT) <= type; }) - codes.begin();
+        particles.typeBegin[type + 1] = end;
+        if (end > begin)
+        {
+            roots[type] = (uint32_t)nodes.size();
+            nodes.resize(nodes.size() + 1);
+            buildNode(codes, (uint32_t)begin, (uint32_t)end, 0, roots[type]);
+        }
+    }
+    particles.typesGrouped = true;
+
+    // Blätter parallel: enge Bounding-Box und Summen für das Aggregat
+    std::vector<uint32_t> leaves;
+    for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+    {
+        if (nodes[i].childCount == 0) leaves.push_back(i);
+    }
+    std::vector<Accumulator> sums(nodes.size());
+    forEach(threadPool, leaves.size(), [&](size_t leaf) {
+        Node& node = nodes[leaves[leaf]];
+        Accumulator& sum = sums[leaves[leaf]];
+        float bounds[6] = { INFINITY, INFINITY, INFINITY, -INFINITY, -INFINITY, -INFINITY };
+        for (uint32_t i = node.begin; i < node.begin + node.count; i++)
+        {
+            const float position[3] = { particles.x[i], particles.y[i], particles.z[i] };
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (position[axis] < bounds[axis]) bounds[axis] = position[axis];
+                if (position[axis] > bounds[3 + axis]) bounds[3 + axis] = position[axis];
+            }
+            sum.sum[0] += position[0];
+            sum.sum[1] += position[1];
+            sum.sum[2] += position[2];
+            sum.sum[3] += hasDensity ? particles.density[i] : 0.0f;
+        }
+        std::copy(bounds, bounds + 3, node.boundsMin);
+        std::copy(bounds + 3, bounds + 6, node.boundsMax);
+    });
+
+    // Kinder haben größere Indizes als ihr Elternknoten, also von hinten zusammenfassen
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        Node& node = nodes[i];
+        for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; c++)
+        {
+            if (c == node.firstChild)
+            {
+                std::copy(nodes[c].boundsMin, nodes[c].boundsMin + 3, node.boundsMin);
+                std::copy(nodes[c].boundsMax, nodes[c].boundsMax + 3, node.boundsMax);
+            }
+            for (int axis = 0; axis < 3; axis++)
+            {
+                node.boundsMin[axis] = std::min(node.boundsMin[axis], nodes[c].boundsMin[axis]);
+                node.boundsMax[axis] = std::max(node.boundsMax[axis], nodes[c].boundsMax[axis]);
+            }
+            for (int k = 0; k < 4; k++)
+            {
+                sums[i].sum[k] += sums[c].sum[k];
+            }
+        }
+    }
+
+    // Ein Aggregat pro Knoten mit mehr als einem Partikel, alle Partikel eines Baums haben denselben Typ
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        Node& node = nodes[i];
+        node.lodBegin = (uint32_t)lodX.size();
+        node.lodCount = node.count >= 2 ? 1 : 0;
+        if (node.lodCount == 0) continue;
+        lodX.push_back((float)(sums[i].sum[0] / node.count));
+        lodY.push_back((float)(sums[i].sum[1] / node.count));
+        lodZ.push_back((float)(sums[i].sum[2] / node.count));
+        lodDensity.push_back((float)(sums[i].sum[3] / node.count));
+        lodWeight.push_back((float)node.count);
+        lodType.push_back((uint8_t)typeOf(node.begin));
+    }
+}
+
+void ParticleOctree::buildNode(const std::vector<uint32_t>& codes, uint32_t begin, uint32_t end, int level, uint32_t nodeIndex)
+{
+    Node& node = nodes[nodeIndex];
+    node.begin = begin;
+    node.count = end - begin;
+    node.firstChild = 0;
+    node.childCount = 0;
+    if (node.count <= LEAF_SIZE || level >= MAX_DEPTH)
+    {
+        return;
+    }
+
+    // Innerhalb des Knotens sind die Codes sortiert, die Oktanten liegen also hintereinander
+    const int shift = 3 * (MAX_DEPTH - 1 - level);
+    uint32_t split[9];
+    split[0] = begin;
+    split[8] = end;
+    for (uint32_t octant = 1; octant < 8; octant++)
+    {
+        split[octant] = (uint32_t)(std::partition_point(codes.begin() + split[octant - 1], codes.begin() + end,
+            [shift, octant](uint32_t code) { return ((code >> shift) & 7) < octant; }) - codes.begin());
+    }
+
+    uint32_t firstChild = (uint32_t)nodes.size();
+    uint32_t childCount = 0;
+    for (int octant = 0; octant < 8; octant++)
+    {
+        if (split[octant + 1] > split[octant]) childCount++;
+    }
+    nodes.resize(firstChild + childCount);
+    nodes[nodeIndex].firstChild = firstChild;
+    nodes[nodeIndex].childCount = childCount;
+
+    uint32_t child = firstChild;
+    for (int octant = 0; octant < 8; octant++)
+    {
+        if (split[octant + 1] > split[octant])
+        {
+            buildNode(codes, split[octant], split[octant + 1], level + 1, child++);
+        }
+    }
+}
+
+void ParticleOctree::select(const float viewProjection[16], float scale, const float eye[3], float pixelsPerUnit, float lodPixels,
+    uint32_t typeMask, Selection& selection) const
+{
+    selection.particleFirst.clear();
+    selection.particleCount.clear();
+    selection.lodFirst.clear();
+    selection.lodCount.clear();
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    // Frustum-Ebenen aus den Zeilen von viewProjection * scale (Gribb/Hartmann),
+    // dadurch gelten sie direkt für die unskalierten Positionen im Store
+    double planes[6][4];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            double factor = k < 3 ? scale : 1.0;
+            double w = viewProjection[4 * k + 3] * factor;
+            double v = viewProjection[4 * k + axis] * factor;
+            planes[2 * axis][k] = w + v;
+            planes[2 * axis + 1][k] = w - v;
+        }
+    }
+
+    auto append = [](std::vector<int32_t>& first, std::vector<int32_t>& count, uint32_t begin, uint32_t length) {
+        // Angrenzende Bereiche zusammenlegen, sichtbare Teilbäume werden so ein Bereich
+        if (!first.empty() && (uint32_t)(first.back() + count.back()) == begin)
+        {
+            count.back() += (int32_t)length;
+            return;
+        }
+        first.push_back((int32_t)begin);
+        count.push_back((int32_t)length);
+    };
+
+    // Tiefensuche, die Kinder werden in Morton-Reihenfolge besucht
+    struct Entry
+    {
+        uint32_t node;
+        bool inside;
+    };
+    std::vector<Entry> stack;
+    for (size_t type = roots.size(); type-- > 0;)
+    {
+        if (roots[type] != NO_NODE && (typeMask & (1u << type)) != 0)
+        {
+            stack.push_back(Entry{ roots[type], false });
+        }
+    }
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[entry.node];
+        if (!(node.boundsMin[0] <= node.boundsMax[0]))
+        {
+            continue;
+        }
+
+        bool inside = entry.inside;
+        if (!inside)
+        {
+            // Positive Ecke jeder Ebene entscheidet über außerhalb, negative über ganz innerhalb
+            bool outside = false;
+            inside = true;
+            for (int p = 0; p < 6 && !outside; p++)
+            {
+                double positive = planes[p][3];
+                double negative = planes[p][3];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    double a = planes[p][axis];
+                    positive += a * (a >= 0.0 ? node.boundsMax[axis] : node.boundsMin[axis]);
+                    negative += a * (a >= 0.0 ? node.boundsMin[axis] : node.boundsMax[axis]);
+                }
+                if (positive < 0.0) outside = true;
+                if (negative < 0.0) inside = false;
+            }
+            if (outside)
+            {
+                continue;
+            }
+        }
+
+        if (pixelsPerUnit > 0.0f && node.lodCount > 0)
+        {
+            double radius = 0.0;
+            double distance = 0.0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                double half = 0.5 * ((double)node.boundsMax[axis] - node.boundsMin[axis]);
+                double center = 0.5 * ((double)node.boundsMax[axis] + node.boundsMin[axis]);
+                radius += half * half;
+                distance += (center - eye[axis]) * (center - eye[axis]);
+            }
+            radius = std::sqrt(radius);
+            distance = std::sqrt(distance);
+            if (distance > radius && 2.0 * radius / distance * pixelsPerUnit < lodPixels)
+            {
+                append(selection.lodFirst, selection.lodCount, node.lodBegin, node.lodCount);
+                continue;
+            }
+        }
+
+        // Ohne LOD braucht ein ganz sichtbarer Knoten keine weiteren Tests
+        if (node.childCount == 0 || (inside && pixelsPerUnit <= 0.0f))
+        {
+            append(selection.particleFirst, selection.particleCount, node.begin, node.count);
+            continue;
+        }
+        for (uint32_t c = node.firstChild + node.childCount; c-- > node.firstChild;)
+        {
+            stack.push_back(Entry{ c, inside });
+        }
+    }
+}
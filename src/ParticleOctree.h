@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class ParticleStore;
+class ThreadPool;
+
+// Linear octree over the particle positions of one snapshot, one tree per type.
+// build() groups the store by type and sorts every group by Morton code, so every
+// node covers one contiguous index range and a whole visible subtree is a single
+// draw range. Every node also keeps an aggregated pseudo-particle (centroid, mean
+// density, weight = number of particles) that is drawn instead of the node once it
+// is smaller than a pixel on screen.
+class ParticleOctree
+{
+public:
+    struct Node
+    {
+        float boundsMin[3];
+        float boundsMax[3];
+        uint32_t begin;       // erster Partikel im Store
+        uint32_t count;
+        uint32_t firstChild;  // Kinder liegen hintereinander, 0 = Blatt
+        uint32_t childCount;
+        uint32_t lodBegin;    // Aggregat in lodX, lodY, ...
+        uint32_t lodCount;    // 0 bei Knoten mit nur einem Partikel
+    };
+
+    static const uint32_t NO_NODE = 0xFFFFFFFFu;
+
+    // Draw ranges of one frame, int32 like GLint / GLsizei for glMultiDrawArrays
+    struct Selection
+    {
+        std::vector<int32_t> particleFirst;
+        std::vector<int32_t> particleCount;
+        std::vector<int32_t> lodFirst;
+        std::vector<int32_t> lodCount;
+    };
+
+    // Nodes with at most LEAF_SIZE particles are not split further
+    static const uint32_t LEAF_SIZE = 2048;
+    static const int MAX_DEPTH = 10;
+
+    std::vector<Node> nodes;
+    // Root node per type (ParticleStore::NUM_TYPES entries), NO_NODE if there is none
+    std::vector<uint32_t> roots;
+
+    // Aggregated pseudo-particles, same meaning as the columns of the store
+    std::vector<float> lodX;
+    std::vector<float> lodY;
+    std::vector<float> lodZ;
+    std::vector<float> lodDensity;
+    std::vector<float> lodWeight;
+    std::vector<uint8_t> lodType;
+
+    // Reorders all columns of particles by type and Morton code, records the type
+    // ranges in the store and builds the trees, in parallel when a pool is given
+    void build(ParticleStore& particles, ThreadPool* threadPool);
+    void clear();
+    bool empty() const { return nodes.empty(); }
+    size_t memoryUsage() const;
+
+    // Collects the ranges to draw for viewProjection (column-major, positions are
+    // multiplied by scale first like in the shader). Only the trees of the types in
+    // typeMask are visited and nodes outside the frustum are skipped. Nodes whose
+    // bounding sphere appears smaller than lodPixels pixels are replaced by their
+    // aggregate, pixelsPerUnit is the size in pixels of one unit at distance one
+    // (0 = no LOD).
+    // eye is the camera position in store units (not scaled).
+    void select(const float viewProjection[16], float scale, const float eye[3], float pixelsPerUnit, float lodPixels,
+        uint32_t typeMask, Selection& selection) const;
+
+private:
+    void buildNode(const std::vector<uint32_t>& codes, uint32_t begin, uint32_t end, int level, uint32_t nodeIndex);
+};
@@ -0,0 +1,53 @@
+#include "ParticleStore.h"
+
+template <typename T>
+static void resizeColumn(Column<T>& column, size_t n, bool used)
+{
+    if (used) column.resize(n);
+    else Column<T>().swap(column);
+}
+
+void ParticleStore::resize(size_t n, uint32_t fieldMask)
+{
+    fields = fieldMask | Position;
+    octree.clear();
+    typesGrouped = false;
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+    resizeColumn(density, n, (fields & Density) != 0);
+    resizeColumn(temperature, n, (fields & Temperature) != 0);
+    resizeColumn(mass, n, (fields & Mass) != 0);
+    resizeColumn(type, n, (fields & Type) != 0);
+    resizeColumn(galaxyPart, n, (fields & GalaxyPart) != 0);
+    resizeColumn(id, n, (fields & Id) != 0);
+}
+
+void ParticleStore::reserve(size_t n)
+{
+    x.reserve(n);
+    y.reserve(n);
+    z.reserve(n);
+    density.reserve(n);
+    temperature.reserve(n);
+    mass.reserve(n);
+    type.reserve(n);
+    galaxyPart.reserve(n);
+    id.reserve(n);
+}
+
+void ParticleStore::clear()
+{
+    resize(0, fields);
+}
+
+size_t ParticleStore::memoryUsage() const
+{
+    size_t bytes = 0;
+    bytes += (x.capacity() + y.capacity() + z.capacity()) * sizeof(float);
+    bytes += (density.capacity() + temperature.capacity() + mass.capacity()) * sizeof(float);
+    bytes += (type.capacity() + galaxyPart.capacity()) * sizeof(uint8_t);
+    bytes += id.capacity() * sizeof(uint32_t);
+    bytes += octree.memoryUsage();
+    return bytes;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "ParticleOctree.h"
+
+// Allocator that leaves new elements uninitialized on resize(), the loaders
+// overwrite every element anyway and zero filling 1e7 particles is not free
+template <typename T>
+struct DefaultInitAllocator : std::allocator<T>
+{
+    using std::allocator<T>::allocator;
+
+    template <typename U>
+    struct rebind { using other = DefaultInitAllocator<U>; };
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value)
+    {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T>
+using Column = std::vector<T, DefaultInitAllocator<T>>;
+
+// Columnar particle storage (structure of arrays).
+// Only the fields the renderer actually reads are kept.
+class ParticleStore
+{
+public:
+    // Columns that can be requested from the loader, unrequested columns stay empty
+    enum Field : uint32_t
+    {
+        Position = 1 << 0,
+        Density = 1 << 1,
+        Temperature = 1 << 2,
+        Mass = 1 << 3,
+        Type = 1 << 4,
+        GalaxyPart = 1 << 5,
+        Id = 1 << 6,
+        AllFields = (1 << 7) - 1
+    };
+
+    // Position
+    Column<float> x;
+    Column<float> y;
+    Column<float> z;
+
+    // Scalar properties
+    Column<float> density;
+    Column<float> temperature;
+    Column<float> mass;
+
+    Column<uint8_t> type;       // 1 = star, 2 = gas, 3 = dark matter
+    Column<uint8_t> galaxyPart; // 1 = disk, 2 = bulge, 3 = halo
+    Column<uint32_t> id;
+
+    // Columns that hold data, positions are always there
+    uint32_t fields = AllFields;
+
+    // Types 0 to NUM_TYPES - 1, other values count as 0 (unknown)
+    static const int NUM_TYPES = 4;
+    // Set by the loader: particles of type t lie in [typeBegin[t], typeBegin[t + 1]).
+    // Without the type column everything is in the range of type 0
+    bool typesGrouped = false;
+    size_t typeBegin[NUM_TYPES + 1] = {};
+
+    // Spatial index, built by the loader (empty = particles are in file order)
+    ParticleOctree octree;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    bool hasFields(uint32_t mask) const { return (fields & mask) == mask; }
+
+    // Resize the columns in the field mask to n particles and free the others,
+    // new elements are left uninitialized. Drops the octree and the type ranges
+    void resize(size_t n, uint32_t fieldMask = AllFields);
+    void reserve(size_t n);
+    // Remove all particles but keep the allocated memory
+    void clear();
+    // Bytes currently allocated by all columns
+    size_t memoryUsage() const;
+};
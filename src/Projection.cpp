@@ -0,0 +1,230 @@
+// Alle Varianten müssen bitgleich zu projectPoint rechnen, also keine fused multiply-adds
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "Projection.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PROJECTION_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PROJECTION_TARGET(isa)
+#else
+#define PROJECTION_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+    typedef void (*ProjectKernel)(const float*, float, const float*, const float*, const float*, size_t, int, int, float*, float*, uint8_t*);
+
+    void projectScalar(const float* m, float scale, const float* x, const float* y, const float* z, size_t count,
+        int width, int height, float* windowX, float* windowY, uint8_t* visible)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            visible[i] = projectPoint(m, scale, x[i], y[i], z[i], width, height, windowX[i], windowY[i]) ? 1 : 0;
+        }
+    }
+
+#if defined(PROJECTION_X86)
+    PROJECTION_TARGET("sse2")
+    void projectSSE2(const float* m, float scale, const float* x, const float* y, const float* z, size_t count,
+        int width, int height, float* windowX, float* windowY, uint8_t* visible)
+    {
+        const __m128 s = _mm_set1_ps(scale);
+        __m128 col[16];
+        for (int k = 0; k < 16; k++) col[k] = _mm_set1_ps(m[k]);
+        const __m128 halfWidth = _mm_set1_ps(width * 0.5f);
+        const __m128 halfHeight = _mm_set1_ps(height * 0.5f);
+        const __m128 subpixel = _mm_set1_ps(256.0f);
+        const __m128 invSubpixel = _mm_set1_ps(1.0f / 256.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 px = _mm_mul_ps(_mm_loadu_ps(x + i), s);
+            __m128 py = _mm_mul_ps(_mm_loadu_ps(y + i), s);
+            __m128 pz = _mm_mul_ps(_mm_loadu_ps(z + i), s);
+            __m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(col[0], px), _mm_mul_ps(col[4], py)), _mm_mul_ps(col[8], pz)), col[12]);
+            __m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(col[1], px), _mm_mul_ps(col[5], py)), _mm_mul_ps(col[9], pz)), col[13]);
+            __m128 cz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(col[2], px), _mm_mul_ps(col[6], py)), _mm_mul_ps(col[10], pz)), col[14]);
+            __m128 cw = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(col[3], px), _mm_mul_ps(col[7], py)), _mm_mul_ps(col[11], pz)), col[15]);
+
+            // Ohne SSE4.1-floor: Abschneiden ist für sichtbare Punkte (>= 0) dasselbe
+            __m128 wx = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_div_ps(cx, cw), halfWidth), halfWidth), subpixel), half);
+            __m128 wy = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_div_ps(cy, cw), halfHeight), halfHeight), subpixel), half);
+            _mm_storeu_ps(windowX + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(wx)), invSubpixel));
+            _mm_storeu_ps(windowY + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(wy)), invSubpixel));
+
+            __m128 negW = _mm_sub_ps(zero, cw);
+            __m128 inside = _mm_cmpgt_ps(cw, zero);
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(cx, negW), _mm_cmple_ps(cx, cw)));
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(cy, negW), _mm_cmple_ps(cy, cw)));
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(cz, negW), _mm_cmple_ps(cz, cw)));
+            int mask = _mm_movemask_ps(inside);
+            for (int k = 0; k < 4; k++) visible[i + k] = (uint8_t)((mask >> k) & 1);
+        }
+        projectScalar(m, scale, x + i, y + i, z + i, count - i, width, height, windowX + i, windowY + i, visible + i);
+    }
+
+    PROJECTION_TARGET("avx2")
+    void projectAVX2(const float* m, float scale, const float* x, const float* y, const float* z, size_t count,
+        int width, int height, float* windowX, float* windowY, uint8_t* visible)
+    {
+        const __m256 s = _mm256_set1_ps(scale);
+        __m256 col[16];
+        for (int k = 0; k < 16; k++) col[k] = _mm256_set1_ps(m[k]);
+        const __m256 halfWidth = _mm256_set1_ps(width * 0.5f);
+        const __m256 halfHeight = _mm256_set1_ps(height * 0.5f);
+        const __m256 subpixel = _mm256_set1_ps(256.0f);
+        const __m256 invSubpixel = _mm256_set1_ps(1.0f / 256.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 zero = _mm256_setzero_ps();
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 px = _mm256_mul_ps(_mm256_loadu_ps(x + i), s);
+            __m256 py = _mm256_mul_ps(_mm256_loadu_ps(y + i), s);
+            __m256 pz = _mm256_mul_ps(_mm256_loadu_ps(z + i), s);
+            __m256 cx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(col[0], px), _mm256_mul_ps(col[4], py)), _mm256_mul_ps(col[8], pz)), col[12]);
+            __m256 cy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(col[1], px), _mm256_mul_ps(col[5], py)), _mm256_mul_ps(col[9], pz)), col[13]);
+            __m256 cz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(col[2], px), _mm256_mul_ps(col[6], py)), _mm256_mul_ps(col[10], pz)), col[14]);
+            __m256 cw = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(col[3], px), _mm256_mul_ps(col[7], py)), _mm256_mul_ps(col[11], pz)), col[15]);
+
+            __m256 wx = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(cx, cw), halfWidth), halfWidth), subpixel), half);
+            __m256 wy = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(cy, cw), halfHeight), halfHeight), subpixel), half);
+            _mm256_storeu_ps(windowX + i, _mm256_mul_ps(_mm256_floor_ps(wx), invSubpixel));
+            _mm256_storeu_ps(windowY + i, _mm256_mul_ps(_mm256_floor_ps(wy), invSubpixel));
+
+            __m256 negW = _mm256_sub_ps(zero, cw);
+            __m256 inside = _mm256_cmp_ps(cw, zero, _CMP_GT_OQ);
+            inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(cx, negW, _CMP_GE_OQ), _mm256_cmp_ps(cx, cw, _CMP_LE_OQ)));
+            inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(cy, negW, _CMP_GE_OQ), _mm256_cmp_ps(cy, cw, _CMP_LE_OQ)));
+            inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(cz, negW, _CMP_GE_OQ), _mm256_cmp_ps(cz, cw, _CMP_LE_OQ)));
+            int mask = _mm256_movemask_ps(inside);
+            for (int k = 0; k < 8; k++) visible[i + k] = (uint8_t)((mask >> k) & 1);
+        }
+        projectScalar(m, scale, x + i, y + i, z + i, count - i, width, height, windowX + i, windowY + i, visible + i);
+    }
+
+    PROJECTION_TARGET("avx512f")
+    void projectAVX512(const float* m, float scale, const float* x, const float* y, const float* z, size_t count,
+        int width, int height, float* windowX, float* windowY, uint8_t* visible)
+    {
+        const __m512 s = _mm512_set1_ps(scale);
+        __m512 col[16];
+        for (int k = 0; k < 16; k++) col[k] = _mm512_set1_ps(m[k]);
+        const __m512 halfWidth = _mm512_set1_ps(width * 0.5f);
+        const __m512 halfHeight = _mm512_set1_ps(height * 0.5f);
+        const __m512 subpixel = _mm512_set1_ps(256.0f);
+        const __m512 invSubpixel = _mm512_set1_ps(1.0f / 256.0f);
+        const __m512 half = _mm512_set1_ps(0.5f);
+        const __m512 zero = _mm512_setzero_ps();
+        const __m512i one = _mm512_set1_epi32(1);
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m512 px = _mm512_mul_ps(_mm512_loadu_ps(x + i), s);
+            __m512 py = _mm512_mul_ps(_mm512_loadu_ps(y + i), s);
+            __m512 pz = _mm512_mul_ps(_mm512_loadu_ps(z + i), s);
+            __m512 cx = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(col[0], px), _mm512_mul_ps(col[4], py)), _mm512_mul_ps(col[8], pz)), col[12]);
+            __m512 cy = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(col[1], px), _mm512_mul_ps(col[5], py)), _mm512_mul_ps(col[9], pz)), col[13]);
+            __m512 cz = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(col[2], px), _mm512_mul_ps(col[6], py)), _mm512_mul_ps(col[10], pz)), col[14]);
+            __m512 cw = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(col[3], px), _mm512_mul_ps(col[7], py)), _mm512_mul_ps(col[11], pz)), col[15]);
+
+            __m512 wx = _mm512_add_ps(_mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_div_ps(cx, cw), halfWidth), halfWidth), subpixel), half);
+            __m512 wy = _mm512_add_ps(_mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_div_ps(cy, cw), halfHeight), halfHeight), subpixel), half);
+            _mm512_storeu_ps(windowX + i, _mm512_mul_ps(_mm512_mask_roundscale_ps(wx, 0xFFFF, wx, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), invSubpixel));
+            _mm512_storeu_ps(windowY + i, _mm512_mul_ps(_mm512_mask_roundscale_ps(wy, 0xFFFF, wy, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), invSubpixel));
+
+            __m512 negW = _mm512_sub_ps(zero, cw);
+            __mmask16 inside = _mm512_cmp_ps_mask(cw, zero, _CMP_GT_OQ);
+            inside &= _mm512_cmp_ps_mask(cx, negW, _CMP_GE_OQ) & _mm512_cmp_ps_mask(cx, cw, _CMP_LE_OQ);
+            inside &= _mm512_cmp_ps_mask(cy, negW, _CMP_GE_OQ) & _mm512_cmp_ps_mask(cy, cw, _CMP_LE_OQ);
+            inside &= _mm512_cmp_ps_mask(cz, negW, _CMP_GE_OQ) & _mm512_cmp_ps_mask(cz, cw, _CMP_LE_OQ);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(visible + i), _mm512_maskz_cvtepi32_epi8(inside, one));
+        }
+        projectScalar(m, scale, x + i, y + i, z + i, count - i, width, height, windowX + i, windowY + i, visible + i);
+    }
+
+    // 0 = scalar, 1 = SSE2, 2 = AVX2, 3 = AVX-512
+    int detectLevel()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        // Das Betriebssystem muss die YMM- bzw. ZMM-Register sichern
+        unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+        bool ymm = (xcr0 & 0x6) == 0x6;
+        bool zmm = (xcr0 & 0xE6) == 0xE6;
+        bool avx2 = false, avx512 = false;
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = avx && ymm && (info[1] & (1 << 5)) != 0;
+            avx512 = zmm && (info[1] & (1 << 16)) != 0;
+        }
+        if (avx512) return 3;
+        if (avx2) return 2;
+        return sse2 ? 1 : 0;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return 3;
+        if (__builtin_cpu_supports("avx2")) return 2;
+        if (__builtin_cpu_supports("sse2")) return 1;
+        return 0;
+#endif
+    }
+#endif
+
+    struct Kernel
+    {
+        ProjectKernel function;
+        const char* name;
+    };
+
+    Kernel selectKernel()
+    {
+#if defined(PROJECTION_X86)
+        switch (detectLevel())
+        {
+        case 3: return { projectAVX512, "avx512" };
+        case 2: return { projectAVX2, "avx2" };
+        case 1: return { projectSSE2, "sse2" };
+        }
+#endif
+        return { projectScalar, "scalar" };
+    }
+
+    const Kernel& kernel()
+    {
+        // Einmal beim ersten Aufruf bestimmt, danach nur noch ein Funktionszeiger
+        static const Kernel selected = selectKernel();
+        return selected;
+    }
+}
+
+void projectPoints(const float viewProjection[16], float scale, const float* x, const float* y, const float* z, size_t count,
+    int width, int height, float* windowX, float* windowY, uint8_t* visible)
+{
+    kernel().function(viewProjection, scale, x, y, z, count, width, height, windowX, windowY, visible);
+}
+
+const char* projectionKernelName()
+{
+    return kernel().name;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// Batch projection of SoA positions into window coordinates, the inner loop of the
+// CPU render paths. The kernel (AVX-512, AVX2, SSE2 or scalar) is chosen once at
+// startup from cpuid. All variants round exactly like projectPoint below (no FMA,
+// same operation order), so the result does not depend on the machine.
+
+// Window coordinates of one point, like the GL viewport transform of
+// viewProjection * vec4(position * scale, 1) snapped to 1/256 pixel.
+// viewProjection is column-major like mat4::data().
+// Returns false if the point lies outside the clip volume.
+inline bool projectPoint(const float viewProjection[16], float scale, float x, float y, float z, int width, int height, float& windowX, float& windowY)
+{
+    const float* m = viewProjection;
+    float px = x * scale;
+    float py = y * scale;
+    float pz = z * scale;
+    float clipX = m[0] * px + m[4] * py + m[8] * pz + m[12];
+    float clipY = m[1] * px + m[5] * py + m[9] * pz + m[13];
+    float clipZ = m[2] * px + m[6] * py + m[10] * pz + m[14];
+    float clipW = m[3] * px + m[7] * py + m[11] * pz + m[15];
+
+    float halfWidth = width * 0.5f;
+    float halfHeight = height * 0.5f;
+    windowX = std::floor((clipX / clipW * halfWidth + halfWidth) * 256.0f + 0.5f) / 256.0f;
+    windowY = std::floor((clipY / clipW * halfHeight + halfHeight) * 256.0f + 0.5f) / 256.0f;
+
+    return clipW > 0.0f && clipX >= -clipW && clipX <= clipW && clipY >= -clipW && clipY <= clipW && clipZ >= -clipW && clipZ <= clipW;
+}
+
+// projectPoint for count points. visible[i] is 1 for points inside the clip volume,
+// windowX / windowY of the others are undefined.
+void projectPoints(const float viewProjection[16], float scale, const float* x, const float* y, const float* z, size_t count,
+    int width, int height, float* windowX, float* windowY, uint8_t* visible);
+
+// Kernel chosen for this CPU: "avx512", "avx2", "sse2" or "scalar"
+const char* projectionKernelName();
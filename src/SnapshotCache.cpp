@@ -0,0 +1,63 @@
+#include "SnapshotCache.h"
+
+SnapshotCache::SnapshotCache(size_t budgetBytes) : budgetBytes(budgetBytes)
+{
+}
+
+std::shared_ptr<ParticleStore> SnapshotCache::get(int timeStep, SnapshotInfo& info, uint32_t fields)
+{
+    auto it = lookup.find(timeStep);
+    if (it == lookup.end() || !it->second->store->hasFields(fields))
+    {
+        return nullptr;
+    }
+
+    // nach vorne holen
+    entries.splice(entries.begin(), entries, it->second);
+    info = it->second->info;
+    return it->second->store;
+}
+
+bool SnapshotCache::contains(int timeStep, uint32_t fields) const
+{
+    auto it = lookup.find(timeStep);
+    return it != lookup.end() && it->second->store->hasFields(fields);
+}
+
+void SnapshotCache::put(int timeStep, std::shared_ptr<ParticleStore> store, const SnapshotInfo& info, std::vector<std::shared_ptr<ParticleStore>>& evicted)
+{
+    auto it = lookup.find(timeStep);
+    if (it != lookup.end())
+    {
+        usedBytes -= it->second->bytes;
+        evicted.push_back(std::move(it->second->store));
+        entries.erase(it->second);
+        lookup.erase(it);
+    }
+
+    size_t bytes = store->memoryUsage();
+    entries.push_front(Entry{ timeStep, std::move(store), info, bytes });
+    lookup[timeStep] = entries.begin();
+    usedBytes += bytes;
+
+    evict(evicted);
+}
+
+void SnapshotCache::setBudget(size_t newBudgetBytes, std::vector<std::shared_ptr<ParticleStore>>& evicted)
+{
+    budgetBytes = newBudgetBytes;
+    evict(evicted);
+}
+
+void SnapshotCache::evict(std::vector<std::shared_ptr<ParticleStore>>& evicted)
+{
+    // Der zuletzt eingefügte Eintrag bleibt immer, auch wenn er allein das Budget sprengt
+    while (usedBytes > budgetBytes && entries.size() > 1)
+    {
+        Entry& last = entries.back();
+        usedBytes -= last.bytes;
+        lookup.erase(last.timeStep);
+        evicted.push_back(std::move(last.store));
+        entries.pop_back();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "DataManager.h"
+#include "ParticleStore.h"
+
+// LRU cache of decoded snapshots, keyed by timestep and limited by a byte budget.
+// Not thread-safe, the owner has to lock around it.
+class SnapshotCache
+{
+public:
+    SnapshotCache(size_t budgetBytes);
+
+    // Cached snapshot or nullptr, a hit makes the entry the most recently used one.
+    // Snapshots that were loaded without all columns in fields count as a miss.
+    std::shared_ptr<ParticleStore> get(int timeStep, SnapshotInfo& info, uint32_t fields = ParticleStore::AllFields);
+    bool contains(int timeStep, uint32_t fields = ParticleStore::AllFields) const;
+
+    // Inserts a snapshot and evicts the least recently used ones until the
+    // budget fits again. Evicted stores are appended to evicted.
+    void put(int timeStep, std::shared_ptr<ParticleStore> store, const SnapshotInfo& info, std::vector<std::shared_ptr<ParticleStore>>& evicted);
+
+    void setBudget(size_t budgetBytes, std::vector<std::shared_ptr<ParticleStore>>& evicted);
+    size_t budget() const { return budgetBytes; }
+    size_t usage() const { return usedBytes; }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        int timeStep;
+        std::shared_ptr<ParticleStore> store;
+        SnapshotInfo info;
+        size_t bytes;
+    };
+
+    void evict(std::vector<std::shared_ptr<ParticleStore>>& evicted);
+
+    // front = zuletzt benutzt
+    std::list<Entry> entries;
+    std::unordered_map<int, std::list<Entry>::iterator> lookup;
+    size_t budgetBytes;
+    size_t usedBytes = 0;
+};
@@ -0,0 +1,217 @@
+#include "SnapshotPrefetcher.h"
+#include <algorithm>
+
+SnapshotPrefetcher::SnapshotPrefetcher(DataManager& dataManager, size_t depth, size_t cacheBudgetBytes) : dataManager(dataManager), depth(depth), cache(cacheBudgetBytes)
+{
+    thread = std::thread(&SnapshotPrefetcher::worker, this);
+}
+
+SnapshotPrefetcher::~SnapshotPrefetcher()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        terminate = true;
+        condition.notify_all();
+    }
+    thread.join();
+}
+
+void SnapshotPrefetcher::setNumTimeSteps(int newNumTimeSteps)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (numTimeSteps != newNumTimeSteps)
+    {
+        numTimeSteps = newNumTimeSteps;
+        condition.notify_all();
+    }
+}
+
+void SnapshotPrefetcher::setCacheBudget(size_t bytes)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<std::shared_ptr<ParticleStore>> evicted;
+    cache.setBudget(bytes, evicted);
+    for (auto& store : evicted)
+    {
+        retire(std::move(store));
+    }
+}
+
+std::shared_ptr<ParticleStore> SnapshotPrefetcher::acquire(int timeStep, int newStep, SnapshotInfo& info, uint32_t newFields)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    current = timeStep;
+    step = newStep;
+    fields = newFields;
+
+    while (true)
+    {
+        // Zeitschritte, die nicht mehr vor uns liegen, aus dem Ring in den Cache schieben.
+        // Mit zu wenigen Spalten geladene werden verworfen
+        for (auto it = ring.begin(); it != ring.end();)
+        {
+            bool missingFields = it->loaded && !it->store->hasFields(fields);
+            if (it->ready && (!isWanted(it->timeStep) || missingFields))
+            {
+                if (it->loaded && !missingFields) moveToCache(*it);
+                else retire(std::move(it->store));
+                it = ring.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        condition.notify_all();
+
+        std::shared_ptr<ParticleStore> store = cache.get(timeStep, info, fields);
+        if (store)
+        {
+            return store;
+        }
+
+        condition.wait(lock, [this, timeStep] {
+            Slot* slot = findSlot(timeStep);
+            return slot != nullptr && slot->ready;
+        });
+
+        auto slot = std::find_if(ring.begin(), ring.end(), [timeStep](const Slot& s) { return s.timeStep == timeStep; });
+        if (slot->loaded && !slot->store->hasFields(fields))
+        {
+            // Wurde noch mit der alten Feldmaske geladen
+            continue;
+        }
+
+        info = slot->info;
+        store = slot->store;
+
+        // Fehlgeschlagene Ladevorgänge bleiben im Ring und werden nicht jedes Frame neu versucht
+        if (slot->loaded)
+        {
+            moveToCache(*slot);
+            ring.erase(slot);
+        }
+        return store;
+    }
+}
+
+void SnapshotPrefetcher::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        condition.wait(lock, [this] { return terminate || nextToLoad() >= 0; });
+        if (terminate)
+        {
+            break;
+        }
+
+        int timeStep = nextToLoad();
+        Slot loading;
+        loading.timeStep = timeStep;
+        ring.push_back(std::move(loading));
+        std::shared_ptr<ParticleStore> store = takeStore();
+        uint32_t loadFields = fields;
+
+        // Dekodieren ohne Lock, der Render-Thread läuft weiter
+        lock.unlock();
+        SnapshotInfo info;
+        bool loaded = dataManager.loadData(timeStep, *store, info, loadFields);
+        lock.lock();
+
+        Slot* slot = findSlot(timeStep);
+        slot->ready = true;
+        slot->loaded = loaded;
+        slot->store = store;
+        slot->info = info;
+
+        condition.notify_all();
+    }
+}
+
+bool SnapshotPrefetcher::isWanted(int timeStep) const
+{
+    // Der angeforderte Zeitschritt wird immer geladen, auch wenn er fehlschlägt
+    if (timeStep == current)
+    {
+        return true;
+    }
+    if (timeStep < 0 || (numTimeSteps > 0 && timeStep >= numTimeSteps) || step == 0)
+    {
+        return false;
+    }
+    int distance = timeStep - current;
+    return distance % step == 0 && distance / step >= 1 && distance / step <= (int)depth;
+}
+
+SnapshotPrefetcher::Slot* SnapshotPrefetcher::findSlot(int timeStep)
+{
+    for (Slot& slot : ring)
+    {
+        if (slot.timeStep == timeStep)
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+int SnapshotPrefetcher::nextToLoad()
+{
+    // Zuerst der aktuelle Zeitschritt, danach in Abspielrichtung
+    for (int k = 0; k <= (int)depth; k++)
+    {
+        int timeStep = current + k * step;
+        if (!isWanted(timeStep))
+        {
+            break;
+        }
+        if (findSlot(timeStep) == nullptr && !cache.contains(timeStep, fields))
+        {
+            return timeStep;
+        }
+        if (step == 0)
+        {
+            break;
+        }
+    }
+    return -1;
+}
+
+std::shared_ptr<ParticleStore> SnapshotPrefetcher::takeStore()
+{
+    for (auto it = retired.begin(); it != retired.end(); ++it)
+    {
+        // Nur Stores wiederverwenden, die die Engine nicht mehr hält
+        if (it->use_count() == 1)
+        {
+            std::shared_ptr<ParticleStore> store = std::move(*it);
+            retired.erase(it);
+            store->clear();
+            return store;
+        }
+    }
+    return std::make_shared<ParticleStore>();
+}
+
+void SnapshotPrefetcher::retire(std::shared_ptr<ParticleStore> store)
+{
+    if (store)
+    {
+        retired.push_back(std::move(store));
+    }
+    if (retired.size() > depth)
+    {
+        retired.erase(retired.begin());
+    }
+}
+
+void SnapshotPrefetcher::moveToCache(Slot& slot)
+{
+    std::vector<std::shared_ptr<ParticleStore>> evicted;
+    cache.put(slot.timeStep, std::move(slot.store), slot.info, evicted);
+    for (auto& store : evicted)
+    {
+        retire(std::move(store));
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include "DataManager.h"
+#include "ParticleStore.h"
+#include "SnapshotCache.h"
+
+// Decodes the timesteps ahead of the current one on a background thread
+// into a bounded ring, so the render loop does not wait for the disk.
+// Timesteps that were shown stay in an LRU cache, so holding or scrubbing
+// does not decode the same file again.
+class SnapshotPrefetcher
+{
+public:
+    SnapshotPrefetcher(DataManager& dataManager, size_t depth = 4, size_t cacheBudgetBytes = (size_t)2048 << 20);
+    ~SnapshotPrefetcher();
+
+    SnapshotPrefetcher(const SnapshotPrefetcher&) = delete;
+    SnapshotPrefetcher& operator=(const SnapshotPrefetcher&) = delete;
+
+    // Returns the decoded snapshot of timeStep (waits if it is still loading)
+    // and prefetches timeStep + step, timeStep + 2 * step, ... in the background.
+    // step = 0 holds the current timestep, negative steps play backwards.
+    // Only the columns in fields (ParticleStore::Field) are loaded, cached snapshots
+    // without all of them are loaded again.
+    std::shared_ptr<ParticleStore> acquire(int timeStep, int step, SnapshotInfo& info, uint32_t fields = ParticleStore::AllFields);
+
+    // Upper bound for prefetching, 0 = not known yet
+    void setNumTimeSteps(int numTimeSteps);
+    void setCacheBudget(size_t bytes);
+
+private:
+    struct Slot
+    {
+        int timeStep = -1;
+        bool ready = false;
+        bool loaded = false;
+        std::shared_ptr<ParticleStore> store;
+        SnapshotInfo info;
+    };
+
+    void worker();
+    bool isWanted(int timeStep) const;
+    Slot* findSlot(int timeStep);
+    int nextToLoad();
+    std::shared_ptr<ParticleStore> takeStore();
+    void retire(std::shared_ptr<ParticleStore> store);
+    void moveToCache(Slot& slot);
+
+    DataManager& dataManager;
+    size_t depth;
+
+    int current = 0;
+    int step = 1;
+    int numTimeSteps = 0;
+    uint32_t fields = ParticleStore::AllFields;
+
+    std::deque<Slot> ring;
+    SnapshotCache cache;
+    // Nicht mehr benötigte Stores, werden wiederverwendet sobald niemand sie mehr hält
+    std::vector<std::shared_ptr<ParticleStore>> retired;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+    bool terminate = false;
+};
@@ -0,0 +1,315 @@
+#include "SoftwareRenderer.h"
+#include "ColorMap.h"
+#include "Projection.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    float clamp01(float value)
+    {
+        return std::min(std::max(value, 0.0f), 1.0f);
+    }
+
+    // Wie galacticColor im Vertex-Shader
+    void galacticColor(float d, uint8_t type, float densityAv, float rgb[3])
+    {
+        if (densityAv == 0.0f)
+        {
+            rgb[0] = rgb[1] = rgb[2] = 0.0f;
+            return;
+        }
+        float ratio = d / densityAv;
+        float plus = ratio * 100.0f > 1.0f ? ratio / 10.0f : 0.0f;
+        if (type == 2) plus *= 4.0f;
+        rgb[0] = ratio + plus * 10.0f + 0.2f;
+        rgb[1] = plus - 0.2f;
+        rgb[2] = (d > 0.0f ? densityAv * 2.0f / d : 1.0f) + plus + 0.2f;
+        for (int c = 0; c < 3; c++)
+        {
+            rgb[c] = clamp01(rgb[c]);
+        }
+    }
+
+    // Lineare Filterung mit Clamp-to-Edge wie textureLod auf der 1D-Textur
+    void sampleLut(const std::vector<float>& lut, float t, float rgb[3])
+    {
+        float u = t * ColorMap::LUT_SIZE - 0.5f;
+        float base = std::floor(u);
+        float f = u - base;
+        int i0 = std::min(std::max((int)base, 0), ColorMap::LUT_SIZE - 1);
+        int i1 = std::min(std::max((int)base + 1, 0), ColorMap::LUT_SIZE - 1);
+        for (int c = 0; c < 3; c++)
+        {
+            rgb[c] = lut[3 * i0 + c] * (1.0f - f) + lut[3 * i1 + c] * f;
+        }
+    }
+
+    void transform(const float m[16], const float v[4], float out[4])
+    {
+        // Spaltenweise gespeichert wie in mat4::data()
+        for (int row = 0; row < 4; row++)
+        {
+            out[row] = m[row] * v[0] + m[4 + row] * v[1] + m[8 + row] * v[2] + m[12 + row] * v[3];
+        }
+    }
+}
+
+void SoftwareRenderer::resize(int width, int height)
+{
+    frameWidth = std::max(width, 1);
+    frameHeight = std::max(height, 1);
+    tilesX = (frameWidth + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (frameHeight + TILE_SIZE - 1) / TILE_SIZE;
+    frame.assign((size_t)frameWidth * frameHeight * 3, 0);
+    bins.clear();
+}
+
+void SoftwareRenderer::forEach(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (threadPool)
+    {
+        threadPool->parallelTasks(count, fn);
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        fn(i);
+    }
+}
+
+void SoftwareRenderer::splat(std::vector<std::vector<Splat>>& tileBins, float windowX, float windowY, float size, float r, float g, float b) const
+{
+    // Pixel, deren Mitte in [window - half, window + half) liegt, mindestens eins
+    float half = std::max(size, 1.0f) * 0.5f;
+    int x0 = std::max((int)std::ceil(windowX - half - 0.5f), 0);
+    int x1 = std::min((int)std::ceil(windowX + half - 0.5f), frameWidth);
+    int y0 = std::max((int)std::ceil(windowY - half - 0.5f), 0);
+    int y1 = std::min((int)std::ceil(windowY + half - 0.5f), frameHeight);
+
+    for (int y = y0; y < y1; y++)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            int tile = (y / TILE_SIZE) * tilesX + x / TILE_SIZE;
+            uint32_t local = (uint32_t)((y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE);
+            tileBins[tile].push_back(Splat{ local, r, g, b });
+        }
+    }
+}
+
+void SoftwareRenderer::render(const mat4& projection, const mat4& view, const std::vector<Point>& points, const ParticleStore* particles, const ParticleStyle& style)
+{
+    if (frame.empty())
+    {
+        resize(frameWidth, frameHeight);
+    }
+
+    // projection * view wie im Shader zuerst zusammenfassen
+    float viewProjection[16];
+    const float* p = projection.data();
+    const float* v = view.data();
+    for (int col = 0; col < 4; col++)
+    {
+        transform(p, v + 4 * col, viewProjection + 4 * col);
+    }
+
+    if (style.colorSource == 0 && style.colorMode != lutMode)
+    {
+        std::vector<uint8_t> table = ColorMap::lookupTable(style.colorMode);
+        lut.resize(table.size());
+        for (size_t i = 0; i < table.size(); i++)
+        {
+            lut[i] = table[i] / 255.0f;
+        }
+        lutMode = style.colorMode;
+    }
+
+    const size_t n = particles ? particles->size() : 0;
+    const bool hasType = particles && particles->hasFields(ParticleStore::Type);
+    const bool hasDensity = particles && particles->hasFields(ParticleStore::Density);
+    const uint32_t typeMask = hasType ? style.typeMask : 0xFFFFFFFFu;
+
+    // Vom Loader nach Typ gruppierte Stores: nur die Bereiche der sichtbaren Typen,
+    // sonst alles mit Test pro Partikel
+    std::vector<std::pair<size_t, size_t>> ranges;
+    const bool filterTypes = !(particles && particles->typesGrouped);
+    if (filterTypes)
+    {
+        ranges.emplace_back(0, n);
+    }
+    else
+    {
+        for (int type = 0; type < ParticleStore::NUM_TYPES; type++)
+        {
+            size_t begin = particles->typeBegin[type];
+            size_t end = particles->typeBegin[type + 1];
+            if (end == begin || (typeMask & (1u << type)) == 0) continue;
+            if (!ranges.empty() && ranges.back().second == begin) ranges.back().second = end;
+            else ranges.emplace_back(begin, end);
+        }
+    }
+    size_t total = 0;
+    for (const auto& range : ranges)
+    {
+        total += range.second - range.first;
+    }
+
+    // Chunk 0 sind die Punkte, danach die Partikel der Bereiche hintereinander in festen Blöcken
+    const size_t numChunks = 1 + (total + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const size_t numTiles = (size_t)tilesX * tilesY;
+    bins.resize(numChunks);
+    for (auto& chunk : bins)
+    {
+        chunk.resize(numTiles);
+        for (auto& tile : chunk)
+        {
+            tile.clear();
+        }
+    }
+
+    forEach(numChunks, [&](size_t chunk) {
+        std::vector<std::vector<Splat>>& tileBins = bins[chunk];
+        // Projektion in Blöcken mit dem SIMD-Kernel, danach Farbe und Splat pro sichtbarem Punkt
+        float positionX[BATCH_SIZE], positionY[BATCH_SIZE], positionZ[BATCH_SIZE];
+        float windowX[BATCH_SIZE], windowY[BATCH_SIZE];
+        uint8_t visible[BATCH_SIZE];
+
+        if (chunk == 0)
+        {
+            for (size_t begin = 0; begin < points.size(); begin += BATCH_SIZE)
+            {
+                size_t count = std::min(points.size() - begin, (size_t)BATCH_SIZE);
+                for (size_t k = 0; k < count; k++)
+                {
+                    positionX[k] = points[begin + k].x;
+                    positionY[k] = points[begin + k].y;
+                    positionZ[k] = points[begin + k].z;
+                }
+                projectPoints(viewProjection, 1.0f, positionX, positionY, positionZ, count, frameWidth, frameHeight, windowX, windowY, visible);
+                for (size_t k = 0; k < count; k++)
+                {
+                    if (!visible[k]) continue;
+                    // Bei 8-Bit-Framebuffern klemmt GL Farbe und alpha vor dem Blending auf [0, 1]
+                    const Point& point = points[begin + k];
+                    float alpha = clamp01(point.alpha);
+                    splat(tileBins, windowX[k], windowY[k], point.size, clamp01(point.r) * alpha, clamp01(point.g) * alpha, clamp01(point.b) * alpha);
+                }
+            }
+            return;
+        }
+
+        auto drawParticles = [&](size_t rangeBegin, size_t rangeEnd) {
+            for (size_t begin = rangeBegin; begin < rangeEnd; begin += BATCH_SIZE)
+            {
+                size_t count = std::min(rangeEnd - begin, (size_t)BATCH_SIZE);
+                projectPoints(viewProjection, style.scale, particles->x.data() + begin, particles->y.data() + begin, particles->z.data() + begin,
+                    count, frameWidth, frameHeight, windowX, windowY, visible);
+
+                for (size_t k = 0; k < count; k++)
+                {
+                    size_t i = begin + k;
+                    uint8_t type = hasType ? particles->type[i] : 0;
+                    if (!visible[k] || (filterTypes && (typeMask & (1u << type)) == 0))
+                    {
+                        continue;
+                    }
+
+                    float rgb[3] = { 1.0f, 1.0f, 1.0f };
+                    if (style.colorSource == 1)
+                    {
+                        if (type == 1) { rgb[0] = 1.0f; rgb[1] = 0.0f; rgb[2] = 0.0f; }
+                        else if (type == 2) { rgb[0] = 0.0f; rgb[1] = 1.0f; rgb[2] = 0.0f; }
+                        else if (type == 3) { rgb[0] = 0.0f; rgb[1] = 0.0f; rgb[2] = 1.0f; }
+                    }
+                    else
+                    {
+                        float density = hasDensity ? particles->density[i] : 0.0f;
+                        if (style.colorMode == ColorMap::GALACTIC || lut.empty())
+                        {
+                            galacticColor(density, type, style.densityAv, rgb);
+                        }
+                        else
+                        {
+                            float t = 0.0f;
+                            if (style.densityAv > 0.0f && density > 0.0f)
+                            {
+                                t = std::min(std::max(0.5f + 0.25f * std::log(density / style.densityAv) / std::log(10.0f), 0.0f), 1.0f);
+                            }
+                            sampleLut(lut, t, rgb);
+                        }
+                    }
+
+                    float alpha = clamp01(style.alpha);
+                    splat(tileBins, windowX[k], windowY[k], style.pointSize, clamp01(rgb[0]) * alpha, clamp01(rgb[1]) * alpha, clamp01(rgb[2]) * alpha);
+                }
+            }
+        };
+
+        // Teil der aneinandergehängten Bereiche, der in diesen Chunk fällt
+        const size_t chunkBegin = (chunk - 1) * CHUNK_SIZE;
+        const size_t chunkEnd = std::min(chunk * CHUNK_SIZE, total);
+        size_t rangeStart = 0;
+        for (const auto& range : ranges)
+        {
+            size_t length = range.second - range.first;
+            size_t from = std::max(chunkBegin, rangeStart);
+            size_t to = std::min(chunkEnd, rangeStart + length);
+            if (from < to)
+            {
+                drawParticles(range.first + from - rangeStart, range.first + to - rangeStart);
+            }
+            rangeStart += length;
+        }
+    });
+
+    forEach(numTiles, [this](size_t tile) { blendTile(tile); });
+}
+
+void SoftwareRenderer::blendTile(size_t tile)
+{
+    // Eigener Framebuffer pro Kachel, die Chunks werden in fester Reihenfolge gemischt.
+    // Sterne wie GL_SRC_ALPHA, GL_ONE in 8-Bit-Kanäle, die Partikel als Float-Summe wie die
+    // Typ-Layer des GL-Pfads, die am Ende auf die Sterne addiert wird
+    unsigned char local[TILE_SIZE * TILE_SIZE * 3] = {};
+    float sum[TILE_SIZE * TILE_SIZE * 3] = {};
+    for (size_t chunk = 0; chunk < bins.size(); chunk++)
+    {
+        for (const Splat& s : bins[chunk][tile])
+        {
+            // Die Farbe ist schon mit alpha multipliziert
+            const float src[3] = { s.r, s.g, s.b };
+            if (chunk == 0)
+            {
+                unsigned char* dst = local + 3 * s.pixel;
+                for (int c = 0; c < 3; c++)
+                {
+                    float value = dst[c] + src[c] * 255.0f;
+                    dst[c] = value >= 255.0f ? 255 : (unsigned char)(value + 0.5f);
+                }
+            }
+            else
+            {
+                float* dst = sum + 3 * s.pixel;
+                for (int c = 0; c < 3; c++)
+                {
+                    dst[c] += src[c];
+                }
+            }
+        }
+    }
+    for (int i = 0; i < TILE_SIZE * TILE_SIZE * 3; i++)
+    {
+        float value = local[i] + sum[i] * 255.0f;
+        local[i] = value >= 255.0f ? 255 : (unsigned char)(value + 0.5f);
+    }
+
+    int tileX = (int)(tile % tilesX) * TILE_SIZE;
+    int tileY = (int)(tile / tilesX) * TILE_SIZE;
+    int columns = std::min(TILE_SIZE, frameWidth - tileX);
+    int rows = std::min(TILE_SIZE, frameHeight - tileY);
+    for (int row = 0; row < rows; row++)
+    {
+        std::copy(local + 3 * row * TILE_SIZE, local + 3 * (row * TILE_SIZE + columns), frame.begin() + 3 * ((size_t)(tileY + row) * frameWidth + tileX));
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "mat4.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+
+// CPU point splatter that produces the same image as the OpenGL path of the engine
+// (same projection, points of at least one pixel, stars blended additively into 8 bit
+// channels and the particles summed in float like the type layers) without a GPU.
+// Points are projected in fixed size chunks and binned by screen tile, then every tile
+// is blended in its own small framebuffer in chunk order. Chunk and tile boundaries do
+// not depend on the number of threads, so the image is bit-identical between runs.
+class SoftwareRenderer
+{
+public:
+    // Point with its own size and colour, used for the background stars
+    struct Point
+    {
+        float x, y, z;
+        float size;
+        float r, g, b, alpha;
+    };
+
+    // Same meaning as the uniforms of the particle shader
+    struct ParticleStyle
+    {
+        float scale = 1.0f;
+        uint32_t typeMask = 0xFFFFFFFFu;
+        int colorSource = 0;       // 0 = Dichte mit Colormap, 1 = Farbe nach Typ
+        int colorMode = 2;
+        float densityAv = 0.0f;
+        float alpha = 1.0f;
+        float pointSize = 1.0f;
+    };
+
+    static const int TILE_SIZE = 64;
+    static const size_t CHUNK_SIZE = (size_t)1 << 16;
+    // Points per call of the projection kernel
+    static const int BATCH_SIZE = 1024;
+
+    // Without a pool everything runs on the calling thread
+    ThreadPool* threadPool = nullptr;
+
+    void resize(int width, int height);
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+
+    // Clears the frame and draws the points (unscaled) followed by the particles
+    void render(const mat4& projection, const mat4& view, const std::vector<Point>& points, const ParticleStore* particles, const ParticleStyle& style);
+
+    // RGB, bottom row first like glReadPixels
+    const std::vector<unsigned char>& pixels() const { return frame; }
+
+private:
+    struct Splat
+    {
+        uint32_t pixel;
+        float r, g, b;
+    };
+
+    void splat(std::vector<std::vector<Splat>>& bins, float windowX, float windowY, float size, float r, float g, float b) const;
+    void blendTile(size_t tile);
+    void forEach(size_t count, const std::function<void(size_t)>& fn);
+
+    int frameWidth = 0;
+    int frameHeight = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<unsigned char> frame;
+
+    // bins[chunk][tile], Kapazität bleibt zwischen Frames erhalten
+    std::vector<std::vector<std::vector<Splat>>> bins;
+    std::vector<float> lut;
+    int lutMode = -1;
+};
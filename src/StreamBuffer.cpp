@@ -0,0 +1,125 @@
+#include "StreamBuffer.h"
+#include <iostream>
+
+char* StreamBuffer::beginWrite(size_t bytes)
+{
+    if (bytes > regionSize || buffer == 0)
+    {
+        // Etwas Reserve, damit leicht wachsende Zeitschritte nicht jedes Mal neu anlegen
+        allocate(bytes + bytes / 4);
+    }
+
+    current = (current + 1) % numRegions;
+    waitForRegion(current);
+    writeBytes = bytes;
+
+    if (mapped)
+    {
+        return mapped + current * regionSize;
+    }
+    staging.resize(bytes);
+    return staging.data();
+}
+
+size_t StreamBuffer::endWrite()
+{
+    size_t offset = current * regionSize;
+    if (!mapped && writeBytes > 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, writeBytes, staging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    return offset;
+}
+
+void StreamBuffer::fence()
+{
+    if (buffer == 0)
+    {
+        return;
+    }
+    if (fences[current])
+    {
+        glDeleteSync(fences[current]);
+    }
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamBuffer::waitForRegion(int region)
+{
+    if (!fences[region])
+    {
+        return;
+    }
+    // Erst beim zweiten Versuch flushen, meistens ist der Fence längst erreicht
+    GLbitfield flags = 0;
+    while (true)
+    {
+        GLenum result = glClientWaitSync(fences[region], flags, 1000000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+        {
+            break;
+        }
+        flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    }
+    glDeleteSync(fences[region]);
+    fences[region] = nullptr;
+}
+
+void StreamBuffer::allocate(size_t regionBytes)
+{
+    release();
+
+    // Regionen auf 256 Byte ausrichten, damit jedes Attribut ausgerichtet beginnt
+    regionSize = (regionBytes + 255) & ~(size_t)255;
+    if (regionSize == 0) regionSize = 256;
+    const size_t totalSize = regionSize * numRegions;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+        mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags));
+        if (!mapped)
+        {
+            std::cerr << "Warning: persistent mapping failed, using glBufferSubData" << std::endl;
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+        }
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    current = 0;
+}
+
+void StreamBuffer::release()
+{
+    for (int region = 0; region < numRegions; region++)
+    {
+        waitForRegion(region);
+    }
+    if (buffer != 0)
+    {
+        if (mapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+    regionSize = 0;
+    staging.clear();
+    staging.shrink_to_fit();
+}
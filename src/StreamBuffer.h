@@ -0,0 +1,47 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstddef>
+
+// GL buffer split into three regions that are written in turn, for data that
+// changes every few frames (the particles of the current timestep).
+// With ARB_buffer_storage the buffer stays persistently and coherently mapped and
+// the CPU writes straight into it. A fence per region makes sure a region is not
+// overwritten while the GPU still reads it, so there is no glBufferData orphan.
+// Without buffer storage the data goes through a CPU copy and glBufferSubData.
+class StreamBuffer
+{
+public:
+    static const int numRegions = 3;
+
+    StreamBuffer() = default;
+    ~StreamBuffer() = default;
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Pointer to the next region with room for bytes, waits if the GPU still reads it
+    char* beginWrite(size_t bytes);
+    // Makes the written bytes visible to GL and returns the offset of the region in the buffer
+    size_t endWrite();
+    // Call after the last draw call that reads the current region
+    void fence();
+    // Deletes the buffer, needs the GL context
+    void release();
+
+    GLuint id() const { return buffer; }
+    bool isPersistent() const { return mapped != nullptr; }
+
+private:
+    void allocate(size_t regionBytes);
+    void waitForRegion(int region);
+
+    GLuint buffer = 0;
+    char* mapped = nullptr;
+    size_t regionSize = 0;
+    int current = 0;
+    size_t writeBytes = 0;
+    GLsync fences[numRegions] = {};
+    std::vector<char> staging;
+};
@@ -0,0 +1,121 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Der aufrufende Thread arbeitet bei parallelFor mit
+    for (unsigned int i = 1; i < numThreads; i++)
+    {
+        workers.emplace_back(&ThreadPool::worker, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        terminate = true;
+        condition.notify_all();
+    }
+    for (std::thread& thread : workers)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::worker()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return !tasks.empty() || terminate; });
+
+            if (terminate && tasks.empty())
+            {
+                break;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks.push(std::move(task));
+    condition.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& fn, size_t minChunk)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    size_t count = end - begin;
+    size_t numChunks = std::min<size_t>(count / std::max<size_t>(minChunk, 1), (size_t)size() * 4);
+    if (numChunks <= 1 || workers.empty())
+    {
+        fn(begin, end);
+        return;
+    }
+
+    struct Job
+    {
+        std::atomic<size_t> next{ 0 };
+        size_t done = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    auto job = std::make_shared<Job>();
+
+    // Holt sich Chunks, bis keine mehr übrig sind. Helfer, die erst nach dem Ende
+    // starten, bekommen keinen Chunk mehr und fassen fn nicht an.
+    auto run = [job, begin, count, numChunks, &fn]() {
+        size_t finished = 0;
+        for (size_t chunk = job->next++; chunk < numChunks; chunk = job->next++)
+        {
+            fn(begin + chunk * count / numChunks, begin + (chunk + 1) * count / numChunks);
+            finished++;
+        }
+        if (finished > 0)
+        {
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->done += finished;
+            job->condition.notify_all();
+        }
+    };
+
+    size_t helpers = std::min<size_t>(workers.size(), numChunks - 1);
+    for (size_t i = 0; i < helpers; i++)
+    {
+        enqueue(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->condition.wait(lock, [&job, numChunks] { return job->done == numChunks; });
+}
+
+void ThreadPool::parallelTasks(size_t count, const std::function<void(size_t)>& fn)
+{
+    parallelFor(0, count, [&fn](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+        {
+            fn(i);
+        }
+    }, 1);
+}
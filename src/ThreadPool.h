@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data parallel loops
+class ThreadPool
+{
+public:
+    // numThreads = 0 uses all hardware threads
+    ThreadPool(unsigned int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads that work on a parallelFor, including the calling thread
+    unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+    // Splits [begin, end) into contiguous chunks of at least minChunk elements and
+    // calls fn(chunkBegin, chunkEnd) for each of them. The calling thread helps and
+    // the call returns when all chunks are done. Chunk boundaries only depend on the
+    // range and the pool size, and it is safe to call from inside a pool task.
+    void parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& fn, size_t minChunk = 1 << 16);
+
+    // Runs fn(i) for i in [0, count), one task per index
+    void parallelTasks(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    void worker();
+    void enqueue(std::function<void()> task);
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool terminate = false;
+};
@@ -0,0 +1,291 @@
+#include "YuvConversion.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define YUV_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define YUV_TARGET(isa)
+#else
+#define YUV_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+    // Alle Zwischenwerte liegen in [0, 65535], die SIMD-Varianten rechnen deshalb
+    // mit vorzeichenlosen 16 Bit und kommen auf dieselben Bytes
+    inline uint8_t luma(int r, int g, int b)
+    {
+        return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+    inline uint8_t chromaU(int r, int g, int b)
+    {
+        return (uint8_t)((112 * b - 38 * r - 74 * g + 32896) >> 8);
+    }
+    inline uint8_t chromaV(int r, int g, int b)
+    {
+        return (uint8_t)((112 * r - 94 * g - 18 * b + 32896) >> 8);
+    }
+
+    // Zwei Bildzeilen, pairs Pixelpaare, ein U/V-Wert pro 2x2 Block
+    typedef void (*RowKernel)(const uint8_t*, const uint8_t*, int, uint8_t*, uint8_t*, uint8_t*, uint8_t*);
+
+    void rowsScalar(const uint8_t* top, const uint8_t* bottom, int pairs, uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v)
+    {
+        for (int i = 0; i < pairs; i++)
+        {
+            const uint8_t* a = top + 6 * i;
+            const uint8_t* b = bottom + 6 * i;
+            yTop[2 * i] = luma(a[0], a[1], a[2]);
+            yTop[2 * i + 1] = luma(a[3], a[4], a[5]);
+            yBottom[2 * i] = luma(b[0], b[1], b[2]);
+            yBottom[2 * i + 1] = luma(b[3], b[4], b[5]);
+            int r = (a[0] + a[3] + b[0] + b[3] + 2) >> 2;
+            int g = (a[1] + a[4] + b[1] + b[4] + 2) >> 2;
+            int bl = (a[2] + a[5] + b[2] + b[5] + 2) >> 2;
+            u[i] = chromaU(r, g, bl);
+            v[i] = chromaV(r, g, bl);
+        }
+    }
+
+#if defined(YUV_X86)
+    // 16 RGB-Pixel (48 Bytes) in je einen Vektor R, G und B zerlegen
+    YUV_TARGET("ssse3")
+    inline void deinterleave16(const uint8_t* rgb, __m128i& r, __m128i& g, __m128i& b)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+        const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 32));
+        r = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+        g = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+        b = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(a, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+    }
+
+    YUV_TARGET("ssse3")
+    inline __m128i luma8(__m128i r, __m128i g, __m128i b)
+    {
+        __m128i y = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+            _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+        return _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+    }
+
+    YUV_TARGET("ssse3")
+    inline __m128i luma16(__m128i r, __m128i g, __m128i b)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lo = luma8(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = luma8(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero));
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    // Mittelwert der 2x2 Blöcke als 16 Bit, aus je 16 Pixeln zweier Zeilen
+    YUV_TARGET("ssse3")
+    inline __m128i blockMean(__m128i top, __m128i bottom)
+    {
+        const __m128i ones = _mm_set1_epi8(1);
+        __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(top, ones), _mm_maddubs_epi16(bottom, ones));
+        return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+    }
+
+    YUV_TARGET("ssse3")
+    void rowsSSSE3(const uint8_t* top, const uint8_t* bottom, int pairs, uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v)
+    {
+        const __m128i bias = _mm_set1_epi16((short)32896);
+        int i = 0;
+        for (; i + 8 <= pairs; i += 8)
+        {
+            __m128i rA, gA, bA, rB, gB, bB;
+            deinterleave16(top + 6 * i, rA, gA, bA);
+            deinterleave16(bottom + 6 * i, rB, gB, bB);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(yTop + 2 * i), luma16(rA, gA, bA));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(yBottom + 2 * i), luma16(rB, gB, bB));
+
+            __m128i r = blockMean(rA, rB);
+            __m128i g = blockMean(gA, gB);
+            __m128i b = blockMean(bA, bB);
+            __m128i cu = _mm_sub_epi16(_mm_sub_epi16(_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(112)), bias),
+                _mm_mullo_epi16(r, _mm_set1_epi16(38))), _mm_mullo_epi16(g, _mm_set1_epi16(74)));
+            __m128i cv = _mm_sub_epi16(_mm_sub_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(112)), bias),
+                _mm_mullo_epi16(g, _mm_set1_epi16(94))), _mm_mullo_epi16(b, _mm_set1_epi16(18)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(u + i), _mm_packus_epi16(_mm_srli_epi16(cu, 8), _mm_setzero_si128()));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(v + i), _mm_packus_epi16(_mm_srli_epi16(cv, 8), _mm_setzero_si128()));
+        }
+        rowsScalar(top + 6 * i, bottom + 6 * i, pairs - i, yTop + 2 * i, yBottom + 2 * i, u + i, v + i);
+    }
+
+    // 32 Pixel: Lane 0 = Pixel 0-15, Lane 1 = Pixel 16-31. Entpacken und Packen bleiben
+    // innerhalb der Lanes, die Reihenfolge stimmt also ohne Permutation
+    YUV_TARGET("avx2")
+    inline void deinterleave32(const uint8_t* rgb, __m256i& r, __m256i& g, __m256i& b)
+    {
+        __m128i r0, g0, b0, r1, g1, b1;
+        deinterleave16(rgb, r0, g0, b0);
+        deinterleave16(rgb + 48, r1, g1, b1);
+        r = _mm256_inserti128_si256(_mm256_castsi128_si256(r0), r1, 1);
+        g = _mm256_inserti128_si256(_mm256_castsi128_si256(g0), g1, 1);
+        b = _mm256_inserti128_si256(_mm256_castsi128_si256(b0), b1, 1);
+    }
+
+    YUV_TARGET("avx2")
+    inline __m256i luma8(__m256i r, __m256i g, __m256i b)
+    {
+        __m256i y = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)), _mm256_mullo_epi16(g, _mm256_set1_epi16(129))),
+            _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(25)), _mm256_set1_epi16(128)));
+        return _mm256_add_epi16(_mm256_srli_epi16(y, 8), _mm256_set1_epi16(16));
+    }
+
+    YUV_TARGET("avx2")
+    inline __m256i luma32(__m256i r, __m256i g, __m256i b)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i lo = luma8(_mm256_unpacklo_epi8(r, zero), _mm256_unpacklo_epi8(g, zero), _mm256_unpacklo_epi8(b, zero));
+        __m256i hi = luma8(_mm256_unpackhi_epi8(r, zero), _mm256_unpackhi_epi8(g, zero), _mm256_unpackhi_epi8(b, zero));
+        return _mm256_packus_epi16(lo, hi);
+    }
+
+    YUV_TARGET("avx2")
+    inline __m256i blockMean(__m256i top, __m256i bottom)
+    {
+        const __m256i ones = _mm256_set1_epi8(1);
+        __m256i sum = _mm256_add_epi16(_mm256_maddubs_epi16(top, ones), _mm256_maddubs_epi16(bottom, ones));
+        return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+    }
+
+    // 16 Werte à 16 Bit zu 16 Bytes, packus arbeitet pro Lane
+    YUV_TARGET("avx2")
+    inline __m128i pack16(__m256i values)
+    {
+        __m256i packed = _mm256_packus_epi16(values, _mm256_setzero_si256());
+        return _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0x08));
+    }
+
+    YUV_TARGET("avx2")
+    void rowsAVX2(const uint8_t* top, const uint8_t* bottom, int pairs, uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v)
+    {
+        const __m256i bias = _mm256_set1_epi16((short)32896);
+        int i = 0;
+        for (; i + 16 <= pairs; i += 16)
+        {
+            __m256i rA, gA, bA, rB, gB, bB;
+            deinterleave32(top + 6 * i, rA, gA, bA);
+            deinterleave32(bottom + 6 * i, rB, gB, bB);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(yTop + 2 * i), luma32(rA, gA, bA));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(yBottom + 2 * i), luma32(rB, gB, bB));
+
+            __m256i r = blockMean(rA, rB);
+            __m256i g = blockMean(gA, gB);
+            __m256i b = blockMean(bA, bB);
+            __m256i cu = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(112)), bias),
+                _mm256_mullo_epi16(r, _mm256_set1_epi16(38))), _mm256_mullo_epi16(g, _mm256_set1_epi16(74)));
+            __m256i cv = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(112)), bias),
+                _mm256_mullo_epi16(g, _mm256_set1_epi16(94))), _mm256_mullo_epi16(b, _mm256_set1_epi16(18)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(u + i), pack16(_mm256_srli_epi16(cu, 8)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i), pack16(_mm256_srli_epi16(cv, 8)));
+        }
+        rowsSSSE3(top + 6 * i, bottom + 6 * i, pairs - i, yTop + 2 * i, yBottom + 2 * i, u + i, v + i);
+    }
+
+    // 0 = scalar, 1 = SSSE3, 2 = AVX2
+    int detectLevel()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool ssse3 = (info[2] & (1 << 9)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        // Das Betriebssystem muss die YMM-Register sichern
+        bool ymm = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+        bool avx2 = false;
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = avx && ymm && (info[1] & (1 << 5)) != 0;
+        }
+        if (avx2) return 2;
+        return ssse3 ? 1 : 0;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return 2;
+        if (__builtin_cpu_supports("ssse3")) return 1;
+        return 0;
+#endif
+    }
+#endif
+
+    struct Kernel
+    {
+        RowKernel function;
+        const char* name;
+    };
+
+    Kernel selectKernel()
+    {
+#if defined(YUV_X86)
+        switch (detectLevel())
+        {
+        case 2: return { rowsAVX2, "avx2" };
+        case 1: return { rowsSSSE3, "ssse3" };
+        }
+#endif
+        return { rowsScalar, "scalar" };
+    }
+
+    const Kernel& kernel()
+    {
+        static const Kernel selected = selectKernel();
+        return selected;
+    }
+}
+
+void rgbToYuv420(const uint8_t* rgb, int width, int height, bool bottomUp, uint8_t* y, uint8_t* u, uint8_t* v)
+{
+    const RowKernel rows = kernel().function;
+    const size_t stride = (size_t)3 * width;
+    const int pairs = width / 2;
+    const int uvWidth = chromaWidth(width);
+
+    for (int row = 0; row < height; row += 2)
+    {
+        // Bei ungerader Höhe zählt die letzte Zeile doppelt, der Mittelwert bleibt derselbe
+        const int nextRow = row + 1 < height ? row + 1 : row;
+        const uint8_t* top = rgb + stride * (bottomUp ? height - 1 - row : row);
+        const uint8_t* bottom = rgb + stride * (bottomUp ? height - 1 - nextRow : nextRow);
+        uint8_t* yTop = y + (size_t)width * row;
+        uint8_t* yBottom = y + (size_t)width * nextRow;
+        uint8_t* uRow = u + (size_t)uvWidth * (row / 2);
+        uint8_t* vRow = v + (size_t)uvWidth * (row / 2);
+
+        rows(top, bottom, pairs, yTop, yBottom, uRow, vRow);
+
+        if (width % 2 == 1)
+        {
+            // Letzte Spalte bei ungerader Breite: Pixel verdoppeln
+            const uint8_t* a = top + 3 * (width - 1);
+            const uint8_t* b = bottom + 3 * (width - 1);
+            const uint8_t topPair[6] = { a[0], a[1], a[2], a[0], a[1], a[2] };
+            const uint8_t bottomPair[6] = { b[0], b[1], b[2], b[0], b[1], b[2] };
+            uint8_t yPair[4];
+            rowsScalar(topPair, bottomPair, 1, yPair, yPair + 2, uRow + pairs, vRow + pairs);
+            yTop[width - 1] = yPair[0];
+            yBottom[width - 1] = yPair[2];
+        }
+    }
+}
+
+const char* yuvKernelName()
+{
+    return kernel().name;
+}
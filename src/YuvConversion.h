@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// RGB to planar YUV 4:2:0 (BT.601, limited range) for the video stream. Every chroma
+// sample is the rounded mean of a 2x2 pixel block. The kernel (AVX2, SSSE3 or scalar)
+// is chosen once at startup from cpuid, all variants use the same integer formulas
+// and produce identical bytes.
+
+// Planes of a width x height frame: y has width * height bytes, u and v have
+// chromaWidth(width) * chromaHeight(height) bytes each
+inline int chromaWidth(int width) { return (width + 1) / 2; }
+inline int chromaHeight(int height) { return (height + 1) / 2; }
+
+// rgb is tightly packed (3 * width bytes per row). With bottomUp the first row of rgb
+// is the bottom row of the image like after glReadPixels, the planes are always top first.
+void rgbToYuv420(const uint8_t* rgb, int width, int height, bool bottomUp, uint8_t* y, uint8_t* u, uint8_t* v);
+
+// Kernel chosen for this CPU: "avx2", "ssse3" or "scalar"
+const char* yuvKernelName();
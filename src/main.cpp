@@ -8,30 +8,28 @@
 #include <filesystem>
 #include "DataManager.h"
 #include "Engine.h"
+#include "SnapshotPrefetcher.h"
 #include <memory>
 #include <thread>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <string>
-#include <windows.h>
-#include <commdlg.h>
-#include <shlobj.h>
-#include <shobjidl.h>
-#include <comdef.h>
-#include <windows.h>
-#include <commdlg.h>
-#include <shlobj.h>
-#include <shobjidl.h>
-#include <comdef.h>
-#include <combaseapi.h>
-#include <shlguid.h>
+#include <chrono>
 
 #define TARGET_FPS 60
+// Speicherbudget für bereits dekodierte Zeitschritte
+#define SNAPSHOT_CACHE_MB 2048
 
 //  Nur unter Windows
 #ifdef WIN32
 #include <Windows.h>
 #include <debugapi.h>
+#include <commdlg.h>
+#include <shlobj.h>
+#include <shobjidl.h>
+#include <comdef.h>
+#include <combaseapi.h>
+#include <shlguid.h>
 #endif
 
 using namespace std;
@@ -39,13 +37,158 @@ namespace fs = std::filesystem;
 
 
 std::string dataFolder = "empty"; // Pfad zum Data-Ordner eine Ebene höher
+ThreadPool threadPool;
 DataManager dataManager("");
 
+// Kommandozeile: --headless rendert das Video ohne Fenster (EGL), --software auf der CPU ohne GPU,
+// --width/--height setzen die Bildgröße, --format/--output/--fps streamen das Video in eine
+// Datei, Pipe oder nach stdout statt BMP-Bilder zu schreiben, --frames rendert nur einen Teil
+bool headless = false;
+bool software = false;
+int videoWidth = 1920;
+int videoHeight = 1080;
+int videoFormat = FrameEncoderPool::BMP_FORMAT;
+std::string videoOutput;
+int videoFrameRate = 30;
+// --frames start:end:stride: Zeitschritte start, start + stride, ... vor end (-1 = bis zum
+// letzten). Mehrere Prozesse teilen sich ein Video z.B. mit 0::4, 1::4, 2::4 und 3::4.
+// Übersprungen werden nur Bilder in Format und Größe dieses Laufs, Render-Modus und Kamera
+// stehen nicht in den Dateien und müssen bei allen Teilen und beim Fortsetzen gleich sein
+int frameStart = 0;
+int frameEnd = -1;
+int frameStride = 1;
+
 void renderLive();
 void renderVideo();
 
-int main()
+static double currentTime()
+{
+    // glfwGetTime gibt es headless nicht, GLFW wird dann nie initialisiert
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool parseFrameRange(const std::string& range)
+{
+    // Leere Felder behalten ihren Standardwert, z.B. "100:" oder "::2"
+    std::string fields[3];
+    int field = 0;
+    for (char c : range)
+    {
+        if (c != ':') fields[field] += c;
+        else if (++field > 2) return false;
+    }
+    try
+    {
+        if (!fields[0].empty()) frameStart = std::stoi(fields[0]);
+        if (!fields[1].empty()) frameEnd = std::stoi(fields[1]);
+        if (!fields[2].empty()) frameStride = std::stoi(fields[2]);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return frameStart >= 0 && frameStride > 0 && (frameEnd < 0 || frameEnd > frameStart);
+}
+
+int main(int argc, char** argv)
 {
+    bool formatGiven = false;
+    for (int a = 1; a < argc; a++)
+    {
+        std::string arg = argv[a];
+        if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--software")
+        {
+            software = true;
+        }
+        else if (arg == "--width" && a + 1 < argc)
+        {
+            videoWidth = atoi(argv[++a]);
+        }
+        else if (arg == "--height" && a + 1 < argc)
+        {
+            videoHeight = atoi(argv[++a]);
+        }
+        else if (arg == "--format" && a + 1 < argc)
+        {
+            std::string format = argv[++a];
+            if (format == "bmp") videoFormat = FrameEncoderPool::BMP_FORMAT;
+            else if (format == "png") videoFormat = FrameEncoderPool::PNG_FORMAT;
+            else if (format == "qoi") videoFormat = FrameEncoderPool::QOI_FORMAT;
+            else if (format == "y4m") videoFormat = FrameEncoderPool::Y4M_FORMAT;
+            else if (format == "rgb") videoFormat = FrameEncoderPool::RGB_FORMAT;
+            else
+            {
+                std::cerr << "Unknown video format: " << format << " (bmp, png, qoi, y4m or rgb)" << std::endl;
+                return 1;
+            }
+            formatGiven = true;
+        }
+        else if (arg == "--output" && a + 1 < argc)
+        {
+            videoOutput = argv[++a];
+        }
+        else if (arg == "--fps" && a + 1 < argc)
+        {
+            videoFrameRate = atoi(argv[++a]);
+        }
+        else if (arg == "--frames" && a + 1 < argc)
+        {
+            std::string range = argv[++a];
+            if (!parseFrameRange(range))
+            {
+                std::cerr << "Invalid frame range: " << range << " (start:end:stride)" << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: AstroGenesis_Render_Programm [--headless] [--software] [--width <pixels>] [--height <pixels>]"
+                " [--format bmp|png|qoi|y4m|rgb] [--output <file|->] [--fps <n>] [--frames start:end:stride]" << std::endl;
+            return 1;
+        }
+    }
+    if (videoWidth <= 0 || videoHeight <= 0)
+    {
+        std::cerr << "Invalid video size " << videoWidth << "x" << videoHeight << std::endl;
+        return 1;
+    }
+    if (!videoOutput.empty() && !formatGiven)
+    {
+        // Ein Ausgabepfad ohne Format heißt Stream, Standard ist Y4M
+        videoFormat = FrameEncoderPool::Y4M_FORMAT;
+    }
+    if (FrameEncoderPool::isStreamFormat(videoFormat) && videoOutput.empty())
+    {
+        std::cerr << "Streaming the video needs --output <file|->" << std::endl;
+        return 1;
+    }
+    if (!FrameEncoderPool::isStreamFormat(videoFormat) && !videoOutput.empty())
+    {
+        std::cerr << "--output only works with the stream formats y4m and rgb, images go to ../Video_Output/<name>/" << std::endl;
+        return 1;
+    }
+    if (FrameEncoderPool::isStreamFormat(videoFormat) && (frameStart != 0 || frameEnd >= 0 || frameStride != 1))
+    {
+        // Jeder Teil würde dieselbe Datei überschreiben, und Lücken im Stream fallen nicht auf
+        std::cerr << "--frames only works with the image formats bmp, png and qoi" << std::endl;
+        return 1;
+    }
+    if (videoFrameRate <= 0)
+    {
+        std::cerr << "Invalid frame rate " << videoFrameRate << std::endl;
+        return 1;
+    }
+    if (videoOutput == "-")
+    {
+        // stdout gehört dem Video, alle Texte und Fragen gehen über stderr
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
     //Tittle of the Programm with information
     std::cout << std::endl << "<--------------------------------------------  Astro Genesis Render Programm ------------------------------------------>"  << std::endl<< std::endl;
 
@@ -99,13 +242,24 @@ int main()
         i++;
     }
 
-    //choose between Rendering a video or liveViewer
-    std::cout << "Choose between rendering a video or liveViewer: " << std::endl;
-    std::cout << "[1]   Video" << std::endl;
-    std::cout << "[2]   LiveViewer" << std::endl;
+    dataManager.threadPool = &threadPool;
+
+    // Datenordner einmal indizieren, danach wird pro Frame nur noch eine Datei geöffnet
+    if (!dataManager.buildIndex())
+    {
+        std::cout << "No snapshots found in the selected folder" << std::endl;
+        return 0;
+    }
 
-    int choice;
-    std::cin >> choice;
+    //choose between Rendering a video or liveViewer
+    int choice = 1;
+    if (!headless && !software)
+    {
+        std::cout << "Choose between rendering a video or liveViewer: " << std::endl;
+        std::cout << "[1]   Video" << std::endl;
+        std::cout << "[2]   LiveViewer" << std::endl;
+        std::cin >> choice;
+    }
 
     //if enter is pressed, the liveViewer will be started, else check the input
     if (choice == 2)
@@ -153,9 +307,20 @@ void renderVideo()
     
     std::cout << "" << std::endl;
     
-    std::vector<std::shared_ptr<Particle>> particles;
-    Engine engine(dataFolder, 0, 0, 0, &particles);
+    Engine engine(dataFolder, dataManager.snapshots.front().deltaTime, 0, dataManager.numSnapshots(), nullptr);
     engine.RenderLive = false;
+    engine.headless = headless;
+    // Der Pool splattet beim Software-Backend und komprimiert die PNG-Bänder
+    engine.threadPool = &threadPool;
+    if (software)
+    {
+        engine.renderBackend = Engine::SOFTWARE_BACKEND;
+    }
+    engine.videoWidth = videoWidth;
+    engine.videoHeight = videoHeight;
+    engine.videoFormat = videoFormat;
+    engine.videoOutput = videoOutput;
+    engine.videoFrameRate = videoFrameRate;
 
     if (!engine.init(1.0)) {
         std::cerr << "Engine initialization failed." << std::endl;
@@ -165,12 +330,10 @@ void renderVideo()
     engine.start();
     engine.videoName = videoName;
 
-    double lastFrameTime = glfwGetTime(); 
+    double lastFrameTime = currentTime();
     double frameTime;
     int frameCount = 0;
     double secondCounter = 0.0;
-    int counter = 0;
-    std::vector<Particle> currentParticles;
 
     engine.cameraSpeed = speed;
     engine.focusedCamera = true;
@@ -202,48 +365,63 @@ void renderVideo()
     std::cin >> renderMode;
     engine.renderMode = renderMode;
 
+    // Zeitschritte werden im Hintergrund geladen, während gerendert wird
+    SnapshotPrefetcher prefetcher(dataManager, 4, (size_t)SNAPSHOT_CACHE_MB << 20);
+    prefetcher.setNumTimeSteps(dataManager.numSnapshots());
+    std::shared_ptr<ParticleStore> snapshot;
+
+    // Nur die Zeitschritte aus --frames. Die Kamera hängt allein vom Zeitschritt ab, also
+    // werden schon geschriebene Bilder übersprungen und ein abgebrochenes Video setzt genau
+    // beim ersten fehlenden Bild wieder ein
+    const int lastFrame = frameEnd < 0 ? (int)engine.numTimeSteps : std::min(frameEnd, (int)engine.numTimeSteps);
+    int skipped = 0;
+    auto nextFrame = [&](int frame) {
+        // Zeitschritt 0 wird nie gespeichert (siehe Engine::update), Maßstab und Dichte
+        // kommen über calibrate, also muss er auch nicht gerendert werden
+        if (frame == 0)
+        {
+            frame += frameStride;
+        }
+        while (frame < lastFrame && engine.pictureExists(frame))
+        {
+            frame += frameStride;
+            skipped++;
+        }
+        return frame;
+    };
+    int counter = nextFrame(frameStart);
+    if (skipped > 0)
+    {
+        std::cout << "Skipping " << skipped << " frames that are already rendered, the other settings must match that run" << std::endl;
+    }
 
-    while (!glfwWindowShouldClose(engine.window))
+    if (counter < lastFrame && counter != 0)
     {
+        // Maßstab und mittlere Dichte kommen wie bei einem ganzen Video aus dem ersten
+        // Zeitschritt, sonst passen die Teile nicht zusammen
+        SnapshotInfo info;
+        snapshot = prefetcher.acquire(0, 0, info, engine.requiredFields());
+        engine.particles = snapshot.get();
+        DataManager::applySnapshotInfo(info, &engine);
+        engine.calibrate();
+    }
 
-        double currentFrameTime = glfwGetTime();
+    while (counter < lastFrame && (engine.headless || !glfwWindowShouldClose(engine.window)))
+    {
+
+        double currentFrameTime = currentTime();
         frameTime = currentFrameTime - lastFrameTime;
         lastFrameTime = currentFrameTime;
 
-        dataManager.loadData(counter, particles, &engine);
+        SnapshotInfo info;
+        snapshot = prefetcher.acquire(counter, frameStride, info, engine.requiredFields());
+        engine.particles = snapshot.get();
+        DataManager::applySnapshotInfo(info, &engine);
         engine.isRunning = true;
 
         engine.update(counter);
-        
-        if (counter >= engine.numTimeSteps  - 1)
-        {
-            engine.clean();
-            glfwTerminate();
-            std::cout << "" << std::endl;
-            std::cout << "" << std::endl;
-            std::cout << "All steps rendered" << std::endl;
-            std::string workingDir = fs::current_path().string();
-            std::cout << "You can find the video in the folder: " << videoName << std::endl;
-            return;
-        }
 
-        if (engine.isRunning)
-        {
-            if (counter >= 0 && counter <= engine.numTimeSteps - 1)
-            {
-                counter = counter + engine.playSpeed;
-            }
-        }
-        if (counter >= engine.numTimeSteps - 1)
-        {
-            counter = engine.numTimeSteps - 1;
-            engine.playSpeed = 0;
-        }
-        if (counter < 0)
-        {
-            counter = 0;
-            engine.playSpeed = 0;
-        }
+        counter = nextFrame(counter + frameStride);
 
         frameCount++;
         secondCounter += frameTime;
@@ -257,24 +435,38 @@ void renderVideo()
             #else
             strcat(numStr, " FPS");
             #endif
-            glfwSetWindowTitle(engine.window, numStr);
+            if (!engine.headless) glfwSetWindowTitle(engine.window, numStr);
             frameCount = 0;
             secondCounter = 0.0;
         }
 
-        dataManager.printProgress((double)counter, (double)engine.numTimeSteps, "");
+        dataManager.printProgress((double)std::min(counter, lastFrame), (double)lastFrame, "");
     }
 
     engine.clean();
-    glfwTerminate();
-    return;
+    if (counter < lastFrame)
+    {
+        // Fenster geschlossen, ein neuer Aufruf macht beim ersten fehlenden Bild weiter
+        return;
+    }
+
+    std::cout << "" << std::endl;
+    std::cout << "" << std::endl;
+    std::cout << "All steps rendered" << std::endl;
+    if (!FrameEncoderPool::isStreamFormat(videoFormat))
+    {
+        std::cout << "You can find the video in the folder: " << videoName << std::endl;
+    }
+    else
+    {
+        std::cout << "The video was streamed to: " << (videoOutput == "-" ? "stdout" : videoOutput) << std::endl;
+    }
 }
 
+
 void renderLive()
 {
-    std::vector<std::shared_ptr<Particle>> particles;
-
-    Engine engine(dataFolder, 0, 0, 0, &particles);
+    Engine engine(dataFolder, dataManager.snapshots.front().deltaTime, 0, dataManager.numSnapshots(), nullptr);
 
     if (!engine.init(1.0)) { // Hier muss der physikalische Faktor übergeben werden
         std::cerr << "Engine initialization failed." << std::endl;
@@ -297,7 +489,9 @@ void renderLive()
     double secondCounter = 0.0;
     int counter = 0;
 
-    std::vector<Particle> currentParticles;
+    SnapshotPrefetcher prefetcher(dataManager, 4, (size_t)SNAPSHOT_CACHE_MB << 20);
+    prefetcher.setNumTimeSteps(dataManager.numSnapshots());
+    std::shared_ptr<ParticleStore> snapshot;
 
     // Haupt-Render-Schleife
     while (!glfwWindowShouldClose(engine.window))
@@ -322,9 +516,11 @@ void renderLive()
             std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>((1.0 / TARGET_FPS - frameTime) * 1000)));
         }
 
-        // load particles
-        dataManager.path = dataFolder;
-        dataManager.loadData(counter, particles, &engine);
+        // load particles (kommen vom Prefetcher, in Abspielrichtung vorgeladen)
+        SnapshotInfo info;
+        snapshot = prefetcher.acquire(counter, engine.isRunning ? (int)engine.playSpeed : 0, info, engine.requiredFields());
+        engine.particles = snapshot.get();
+        DataManager::applySnapshotInfo(info, &engine);
 
         // update particles
         engine.update(counter);
@@ -57,15 +57,13 @@ mat4 mat4::operator*(const mat4& other) const {
 }
 
 // Matrix-Vektor-Multiplikation
-float* mat4::operator*(const float vec[4]) const {
-    static float result[4];
-    for (int i = 0; i < 4; ++i) {
-        result[i] = 0;
-        for (int j = 0; j < 4; ++j) {
-            result[i] += m[i][j] * vec[j];
-        }
+vec4 mat4::operator*(const vec4& v) const {
+    // m[Spalte][Zeile], Ergebnis per Wert statt in einem statischen Array
+    float result[4];
+    for (int row = 0; row < 4; ++row) {
+        result[row] = m[0][row] * v.x + m[1][row] * v.y + m[2][row] * v.z + m[3][row] * v.w;
     }
-    return result;
+    return vec4(result[0], result[1], result[2], result[3]);
 }
 
 // Determinante berechnen
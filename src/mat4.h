@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include "vec3.h"
+#include "vec4.h"
 
 class mat4 {
 public:
@@ -13,7 +14,8 @@ public:
     mat4 operator+(const mat4& other) const;
     mat4 operator-(const mat4& other) const;
     mat4 operator*(const mat4& other) const;
-    float* operator*(const float vec[4]) const;
+    // Spaltenweise wie data() und die Shader: m * v
+    vec4 operator*(const vec4& v) const;
 
     // Methoden
     float determinant() const;
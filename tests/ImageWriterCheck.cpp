@@ -0,0 +1,306 @@
+// Round-trip check for ImageWriter: every QOI file is decoded again by a decoder that
+// follows the specification, and every PNG is read back through zlib, so the hand-written
+// deflate, the sync-flushed bands and the combined Adler-32 are checked by a real inflater.
+// Runs through ctest, exits with 1 on the first broken image.
+#include "ImageWriter.h"
+#include "ThreadPool.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace
+{
+    uint32_t readBigEndian(const uint8_t* data)
+    {
+        return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+    }
+
+    // Dekodiert wie die Spezifikation (Alpha fällt weg) nach RGB, oberste Zeile zuerst
+    bool decodeQoi(const uint8_t* data, size_t size, std::vector<uint8_t>& rgb, int& width, int& height)
+    {
+        if (size < 22 || memcmp(data, "qoif", 4) != 0)
+        {
+            return false;
+        }
+        const uint32_t w = (uint32_t)data[4] << 24 | (uint32_t)data[5] << 16 | (uint32_t)data[6] << 8 | data[7];
+        const uint32_t h = (uint32_t)data[8] << 24 | (uint32_t)data[9] << 16 | (uint32_t)data[10] << 8 | data[11];
+        if (w == 0 || h == 0 || w > 0x7FFFFFFF / h || (data[12] != 3 && data[12] != 4))
+        {
+            return false;
+        }
+        width = (int)w;
+        height = (int)h;
+        const size_t numPixels = (size_t)w * h;
+        rgb.resize(3 * numPixels);
+
+        // Wie in der Spezifikation: Index mit (0, 0, 0, 0), Startpixel (0, 0, 0, 255)
+        uint8_t index[64][4] = {};
+        uint8_t pixel[4] = { 0, 0, 0, 255 };
+        size_t pos = 14;
+        const size_t end = size - 8;
+        int run = 0;
+        for (size_t i = 0; i < numPixels; i++)
+        {
+            if (run > 0)
+            {
+                run--;
+            }
+            else
+            {
+                if (pos >= end)
+                {
+                    return false;
+                }
+                const uint8_t tag = data[pos++];
+                if (tag == 0xFE || tag == 0xFF)
+                {
+                    const size_t channels = tag == 0xFE ? 3 : 4;
+                    if (pos + channels > end)
+                    {
+                        return false;
+                    }
+                    memcpy(pixel, data + pos, channels);
+                    pos += channels;
+                }
+                else if ((tag & 0xC0) == 0x00)
+                {
+                    memcpy(pixel, index[tag], 4);
+                }
+                else if ((tag & 0xC0) == 0x40)
+                {
+                    pixel[0] += ((tag >> 4) & 3) - 2;
+                    pixel[1] += ((tag >> 2) & 3) - 2;
+                    pixel[2] += (tag & 3) - 2;
+                }
+                else if ((tag & 0xC0) == 0x80)
+                {
+                    if (pos >= end)
+                    {
+                        return false;
+                    }
+                    const int dg = (tag & 0x3F) - 32;
+                    const uint8_t next = data[pos++];
+                    pixel[0] += dg - 8 + (next >> 4);
+                    pixel[1] += dg;
+                    pixel[2] += dg - 8 + (next & 0x0F);
+                }
+                else
+                {
+                    run = tag & 0x3F;
+                }
+                memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4);
+            }
+            memcpy(rgb.data() + 3 * i, pixel, 3);
+        }
+        return true;
+    }
+
+    // Liest ein RGB-PNG mit zlib: Chunks und CRCs prüfen, IDAT entpacken (prüft Adler-32), Filter umkehren
+    bool decodePng(const std::vector<uint8_t>& file, std::vector<uint8_t>& rgb, int& width, int& height)
+    {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        if (file.size() < 8 || memcmp(file.data(), signature, 8) != 0)
+        {
+            return false;
+        }
+        std::vector<uint8_t> idat;
+        bool header = false, end = false;
+        size_t pos = 8;
+        while (pos + 12 <= file.size() && !end)
+        {
+            const uint32_t length = readBigEndian(file.data() + pos);
+            const uint8_t* type = file.data() + pos + 4;
+            const uint8_t* body = type + 4;
+            if (pos + 12 + (size_t)length > file.size()
+                || ::crc32(::crc32(0, type, 4), body, length) != readBigEndian(body + length))
+            {
+                return false;
+            }
+            if (memcmp(type, "IHDR", 4) == 0)
+            {
+                // 8 Bit RGB, Standard-Kompression und -Filter, kein Interlacing
+                if (length != 13 || body[8] != 8 || body[9] != 2 || body[10] != 0 || body[11] != 0 || body[12] != 0)
+                {
+                    return false;
+                }
+                width = (int)readBigEndian(body);
+                height = (int)readBigEndian(body + 4);
+                header = true;
+            }
+            else if (memcmp(type, "IDAT", 4) == 0)
+            {
+                idat.insert(idat.end(), body, body + length);
+            }
+            else if (memcmp(type, "IEND", 4) == 0)
+            {
+                end = true;
+            }
+            pos += 12 + (size_t)length;
+        }
+        if (!header || !end || pos != file.size())
+        {
+            return false;
+        }
+
+        const size_t rowBytes = (size_t)3 * width;
+        std::vector<uint8_t> filtered(height * (rowBytes + 1));
+        uLongf filteredSize = (uLongf)filtered.size();
+        if (uncompress(filtered.data(), &filteredSize, idat.data(), (uLong)idat.size()) != Z_OK || filteredSize != filtered.size())
+        {
+            return false;
+        }
+
+        rgb.assign(height * rowBytes, 0);
+        for (int row = 0; row < height; row++)
+        {
+            const uint8_t filter = filtered[row * (rowBytes + 1)];
+            const uint8_t* in = filtered.data() + row * (rowBytes + 1) + 1;
+            uint8_t* line = rgb.data() + row * rowBytes;
+            const uint8_t* above = row > 0 ? line - rowBytes : nullptr;
+            for (size_t i = 0; i < rowBytes; i++)
+            {
+                const int a = i >= 3 ? line[i - 3] : 0;
+                const int b = above ? above[i] : 0;
+                const int c = above && i >= 3 ? above[i - 3] : 0;
+                int predictor = 0;
+                switch (filter)
+                {
+                case 0: predictor = 0; break;
+                case 1: predictor = a; break;
+                case 2: predictor = b; break;
+                case 3: predictor = (a + b) / 2; break;
+                case 4:
+                {
+                    const int p = a + b - c;
+                    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+                    break;
+                }
+                default: return false;
+                }
+                line[i] = (uint8_t)(in[i] + predictor);
+            }
+        }
+        return true;
+    }
+
+    // Die Encoder bekommen die Zeilen von unten nach oben, die Dateien sind von oben nach unten
+    bool matchesImage(const std::vector<uint8_t>& decoded, int decodedWidth, int decodedHeight,
+        const std::vector<uint8_t>& image, int width, int height)
+    {
+        if (decodedWidth != width || decodedHeight != height)
+        {
+            return false;
+        }
+        const size_t stride = (size_t)3 * width;
+        for (int row = 0; row < height; row++)
+        {
+            if (memcmp(decoded.data() + stride * row, image.data() + stride * (height - 1 - row), stride) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Testbilder, die Zeilen von unten nach oben wie bei glReadPixels
+    std::vector<uint8_t> makeImage(const std::string& kind, int width, int height, std::mt19937& random)
+    {
+        std::vector<uint8_t> image((size_t)3 * width * height, 0);
+        if (kind == "noise")
+        {
+            for (uint8_t& value : image) value = (uint8_t)random();
+        }
+        else if (kind == "corner")
+        {
+            // Nicht-schwarzes Pixel oben links, danach schwarz mit vereinzelten Pixeln.
+            // Daran ist der QOI-Index mit RGB-Einträgen ohne Alpha gescheitert
+            uint8_t* corner = image.data() + (size_t)3 * width * (height - 1);
+            corner[0] = 200; corner[1] = 10; corner[2] = 30;
+            for (size_t i = 1; i < image.size() / 3; i += 1 + random() % 7)
+            {
+                if (random() % 3 == 0) continue;
+                image[3 * i] = (uint8_t)(random() % 4);
+                image[3 * i + 1] = (uint8_t)(random() % 4);
+                image[3 * i + 2] = (uint8_t)(random() % 4);
+            }
+        }
+        else if (kind == "particles")
+        {
+            // Schwarzer Hintergrund mit weichen Flecken, ähnelt einem gerenderten Frame
+            for (int blob = 0; blob < 12; blob++)
+            {
+                const int cx = random() % width, cy = random() % height, radius = 2 + random() % 20;
+                for (int y = cy - radius; y <= cy + radius; y++)
+                {
+                    for (int x = cx - radius; x <= cx + radius; x++)
+                    {
+                        const int d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+                        if (x < 0 || y < 0 || x >= width || y >= height || d2 > radius * radius) continue;
+                        uint8_t* pixel = image.data() + 3 * ((size_t)y * width + x);
+                        const int value = 255 - 255 * d2 / (radius * radius + 1);
+                        pixel[0] = (uint8_t)value;
+                        pixel[1] = (uint8_t)(value * 3 / 4);
+                        pixel[2] = (uint8_t)(value / 2);
+                    }
+                }
+            }
+        }
+        return image;
+    }
+}
+
+int main()
+{
+    const int sizes[][2] = { { 1, 1 }, { 37, 5 }, { 64, 130 }, { 321, 199 }, { 640, 257 } };
+    const char* kinds[] = { "black", "corner", "noise", "particles" };
+    std::mt19937 random(2024);
+    ThreadPool threadPool(4);
+    int checked = 0;
+
+    for (const auto& size : sizes)
+    {
+        for (const char* kind : kinds)
+        {
+            const int width = size[0], height = size[1];
+            const std::vector<uint8_t> image = makeImage(kind, width, height, random);
+            const std::string name = std::string(kind) + " " + std::to_string(width) + "x" + std::to_string(height);
+            std::vector<uint8_t> decoded;
+            int decodedWidth = 0, decodedHeight = 0;
+
+            std::vector<uint8_t> qoi;
+            encodeQoi(image.data(), width, height, qoi);
+            if (!decodeQoi(qoi.data(), qoi.size(), decoded, decodedWidth, decodedHeight)
+                || !matchesImage(decoded, decodedWidth, decodedHeight, image, width, height))
+            {
+                fprintf(stderr, "QOI round trip failed: %s\n", name.c_str());
+                return 1;
+            }
+
+            std::vector<uint8_t> png;
+            encodePng(image.data(), width, height, png, nullptr);
+            if (!decodePng(png, decoded, decodedWidth, decodedHeight)
+                || !matchesImage(decoded, decodedWidth, decodedHeight, image, width, height))
+            {
+                fprintf(stderr, "PNG round trip failed: %s\n", name.c_str());
+                return 1;
+            }
+
+            // Die Bänder hängen nicht von der Zahl der Threads ab, also dieselben Bytes
+            std::vector<uint8_t> parallelPng;
+            encodePng(image.data(), width, height, parallelPng, &threadPool);
+            if (parallelPng != png)
+            {
+                fprintf(stderr, "PNG differs with a thread pool: %s\n", name.c_str());
+                return 1;
+            }
+            checked++;
+        }
+    }
+
+    printf("%d images round-tripped through QOI and PNG\n", checked);
+    return 0;
+}